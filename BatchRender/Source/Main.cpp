@@ -0,0 +1,388 @@
+/*
+  ==============================================================================
+
+    Headless batch renderer: runs audio files through DelayPlugInAudioProcessor
+    without a host, spreading the files across worker threads.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#include <atomic>
+#include <iostream>
+#include <set>
+
+//==============================================================================
+struct RenderSettings
+{
+    juce::Array<juce::File> inputFiles;
+    juce::Array<juce::File> outputFiles; //one per input, worked out by resolveOutputFiles() before rendering starts
+    juce::File outputDirectory;
+    juce::File presetFile;
+    std::unique_ptr<juce::XmlElement> preset; //parsed once, applied to every worker's processor
+    juce::StringPairArray parameterValues; //parameter ID -> value, from the command line
+    int blockSize = 8192;
+    int numThreads = juce::SystemStats::getNumCpus();
+    double tailSeconds = -1.0; //negative: however long the processor says its echoes take to die away
+};
+
+//==============================================================================
+// Each worker renders with its own processor instance and pulls the next file index from a
+// shared counter, so fast and slow files balance out across the cores. The processor is created
+// once per worker and re-prepared for each file, so its delay lines and any channel worker
+// threads are reused rather than rebuilt for every file.
+class RenderWorker  : public juce::Thread
+{
+public:
+    RenderWorker (const RenderSettings& s, std::atomic<int>& next, std::atomic<int>& failures)
+        : juce::Thread ("Render worker"), settings (s), nextFile (next), numFailures (failures),
+          processor (createProcessor (s))
+    {
+        formatManager.registerBasicFormats();
+        writerThread.startThread();
+    }
+
+    ~RenderWorker() override
+    {
+        stopThread (-1);
+        writerThread.stopThread (-1);
+        processor->releaseResources();
+    }
+
+    void run() override
+    {
+        for (;;)
+        {
+            auto index = nextFile.fetch_add (1);
+
+            if (index >= settings.inputFiles.size() || threadShouldExit())
+                break;
+
+            if (! renderFile (settings.inputFiles.getReference (index), settings.outputFiles.getReference (index)))
+                ++numFailures;
+        }
+    }
+
+    double getSecondsRendered() const               { return secondsRendered; }
+    int getNumFilesRendered() const                 { return numFilesRendered; }
+    juce::int64 getProcessingTicks() const          { return processingTicks; }
+    juce::int64 getChannelSamplesProcessed() const  { return channelSamplesProcessed; }
+
+private:
+    bool renderFile (const juce::File& inputFile, const juce::File& outputFile)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (inputFile));
+
+        if (reader == nullptr)
+            return reportError (inputFile, "unsupported or unreadable file");
+
+        auto numChannels = (int) reader->numChannels;
+
+        if (numChannels < 1 || numChannels > MAX_CHANNELS)
+            return reportError (inputFile, "too many channels, at most " + juce::String (MAX_CHANNELS) + " are supported");
+
+        // Offline prepares always reset the processor, so nothing carries over from the last file
+        auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (channelSet);
+        layout.outputBuses.add (channelSet);
+
+        processor->setBusesLayout (layout);
+        processor->setRateAndBufferSizeDetails (reader->sampleRate, settings.blockSize);
+        processor->setNonRealtime (true);
+        processor->prepareToPlay (reader->sampleRate, settings.blockSize);
+
+        // Rendered into a temporary file next to the output and only moved into place once it's complete,
+        // so a failed or interrupted render never leaves a truncated file or loses the previous render
+        juce::TemporaryFile tempFile (outputFile);
+        std::unique_ptr<juce::FileOutputStream> stream (tempFile.getFile().createOutputStream());
+
+        if (stream == nullptr)
+            return reportError (outputFile, "couldn't open for writing");
+
+        juce::WavAudioFormat wavFormat;
+        auto bitsPerSample = juce::jmax (16, juce::jmin (32, (int) reader->bitsPerSample));
+        std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor (stream.get(), reader->sampleRate,
+                                                                                    (unsigned int) numChannels,
+                                                                                    bitsPerSample, {}, 0));
+
+        if (writer == nullptr)
+            return reportError (outputFile, "couldn't create a wav writer");
+
+        stream.release(); //the writer owns the stream now
+
+        auto tailSeconds = settings.tailSeconds >= 0.0 ? settings.tailSeconds : processor->getTailLengthSeconds();
+        auto totalSamples = reader->lengthInSamples + (juce::int64) (tailSeconds * reader->sampleRate);
+
+        {
+            // The threaded writer double-buffers through a FIFO, so rendering and disk I/O overlap.
+            // Deleting it flushes whatever is still queued and closes the file
+            juce::AudioFormatWriter::ThreadedWriter threadedWriter (writer.release(), writerThread, settings.blockSize * 4);
+
+            juce::AudioBuffer<float> buffer (numChannels, settings.blockSize);
+            juce::MidiBuffer midi;
+
+            for (juce::int64 position = 0; position < totalSamples; position += settings.blockSize)
+            {
+                auto numSamples = (int) juce::jmin ((juce::int64) settings.blockSize, totalSamples - position);
+
+                buffer.setSize (numChannels, numSamples, false, false, true);
+                reader->read (&buffer, 0, numSamples, position, true, numChannels > 1); //reads past the end are zero-filled
+
+                auto startTicks = juce::Time::getHighResolutionTicks();
+                processor->processBlock (buffer, midi);
+                processingTicks += juce::Time::getHighResolutionTicks() - startTicks;
+                channelSamplesProcessed += (juce::int64) numSamples * numChannels;
+
+                while (! threadedWriter.write (buffer.getArrayOfReadPointers(), numSamples))
+                {
+                    if (threadShouldExit())
+                        return false;
+
+                    wait (1); //FIFO is full, let the writer thread catch up
+                }
+            }
+        }
+
+        if (! tempFile.overwriteTargetFileWithTemporary())
+            return reportError (outputFile, "couldn't move the rendered file into place");
+
+        secondsRendered += (double) totalSamples / reader->sampleRate;
+        ++numFilesRendered;
+        return true;
+    }
+
+    static std::unique_ptr<DelayPlugInAudioProcessor> createProcessor (const RenderSettings& settings)
+    {
+        auto processor = std::make_unique<DelayPlugInAudioProcessor>();
+
+        if (settings.preset != nullptr)
+            processor->applyStateXml (*settings.preset);
+
+        // Command-line values override the preset
+        for (auto* param : processor->getParameters())
+        {
+            if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*> (param))
+            {
+                auto value = settings.parameterValues[rangedParam->paramID];
+
+                if (value.isNotEmpty())
+                    rangedParam->setValueNotifyingHost (rangedParam->convertTo0to1 (value.getFloatValue()));
+            }
+        }
+
+        return processor;
+    }
+
+    static bool reportError (const juce::File& file, const juce::String& message)
+    {
+        std::cerr << file.getFullPathName() << ": " << message << std::endl;
+        return false;
+    }
+
+    const RenderSettings& settings;
+    std::atomic<int>& nextFile;
+    std::atomic<int>& numFailures;
+
+    std::unique_ptr<DelayPlugInAudioProcessor> processor;
+
+    juce::AudioFormatManager formatManager;
+    juce::TimeSliceThread writerThread { "Render writer" };
+
+    double secondsRendered = 0.0;
+    int numFilesRendered = 0;
+    juce::int64 processingTicks = 0;
+    juce::int64 channelSamplesProcessed = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderWorker)
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << "Usage: BatchRender [options] --output <dir> <input files...>" << std::endl
+              << std::endl
+              << "  --output <dir>       directory for the rendered .wav files" << std::endl
+              << "  --preset <file>      preset XML (<DelayPlugInState dryWet=\"..\" .../>)" << std::endl
+              << "  --block <samples>    internal block size (default 8192)" << std::endl
+              << "  --threads <n>        number of worker threads (default: all cores)" << std::endl
+              << "  --tail <seconds>     extra silence rendered after each file for the delay tail" << std::endl
+              << "                       (default: until the echoes have died away by 60 dB, at most "
+              << MAX_TAIL_TIME << " s)" << std::endl
+              << std::endl
+              << "Parameters, overriding the preset (choices and switches take an index, 0 = first / off):" << std::endl;
+
+    // Listed from the processor itself, so the help can't fall behind the parameters
+    DelayPlugInAudioProcessor reference;
+
+    for (auto* param : reference.getParameters())
+    {
+        if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*> (param))
+        {
+            auto& range = rangedParam->getNormalisableRange();
+
+            std::cout << "  " << ("--" + rangedParam->paramID + " <value>").paddedRight (' ', 21)
+                      << rangedParam->getName (64) << ", " << juce::String (range.start) << " to " << juce::String (range.end)
+                      << " (default " << juce::String (range.convertFrom0to1 (rangedParam->getDefaultValue())) << ")" << std::endl;
+        }
+    }
+}
+
+static bool parseArguments (const juce::ArgumentList& args, RenderSettings& settings)
+{
+    DelayPlugInAudioProcessor reference; //only used to look up the valid parameter IDs
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        auto arg = args[i];
+
+        if (! arg.isLongOption())
+        {
+            settings.inputFiles.add (arg.resolveAsFile());
+            continue;
+        }
+
+        if (i + 1 >= args.size())
+            return false;
+
+        auto option = arg.text.substring (2);
+        auto value = args[++i];
+
+        if (option == "output")         settings.outputDirectory = value.resolveAsFile();
+        else if (option == "preset")
+        {
+            settings.presetFile = value.resolveAsFile();
+            settings.preset = juce::parseXML (settings.presetFile);
+
+            if (settings.preset == nullptr)
+            {
+                std::cerr << "Couldn't load preset " << settings.presetFile.getFullPathName() << std::endl;
+                return false;
+            }
+        }
+        else if (option == "block")     settings.blockSize = juce::jmax (1, value.text.getIntValue());
+        else if (option == "threads")   settings.numThreads = juce::jmax (1, value.text.getIntValue());
+        else if (option == "tail")      settings.tailSeconds = juce::jmax (0.0, value.text.getDoubleValue());
+        else
+        {
+            bool isParameter = false;
+
+            for (auto* param : reference.getParameters())
+                if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*> (param))
+                    isParameter = isParameter || rangedParam->paramID == option;
+
+            if (! isParameter)
+            {
+                std::cerr << "Unknown option --" << option << std::endl;
+                return false;
+            }
+
+            settings.parameterValues.set (option, value.text);
+        }
+    }
+
+    return settings.outputDirectory != juce::File() && ! settings.inputFiles.isEmpty();
+}
+
+// Every output is worked out before anything is rendered, so that no two workers ever write the same file.
+// Inputs that would land on the same name - a/kick.wav and b/kick.wav, or kick.aif and kick.wav - are
+// numbered in the order given, and a batch where an output would replace one of the inputs is refused
+static bool resolveOutputFiles (RenderSettings& settings)
+{
+    auto getKey = [] (const juce::File& file)
+    {
+        return juce::File::areFileNamesCaseSensitive() ? file.getFullPathName() : file.getFullPathName().toLowerCase();
+    };
+
+    std::set<juce::String> inputKeys, outputKeys;
+
+    for (auto& input : settings.inputFiles)
+        inputKeys.insert (getKey (input));
+
+    settings.outputFiles.clearQuick();
+
+    for (auto& input : settings.inputFiles)
+    {
+        auto name = input.getFileNameWithoutExtension();
+        auto output = settings.outputDirectory.getChildFile (name + ".wav");
+
+        for (int suffix = 2; outputKeys.count (getKey (output)) != 0; ++suffix)
+            output = settings.outputDirectory.getChildFile (name + " (" + juce::String (suffix) + ").wav");
+
+        if (inputKeys.count (getKey (output)) != 0)
+        {
+            std::cerr << output.getFullPathName() << ": would overwrite an input file, choose another --output directory" << std::endl;
+            return false;
+        }
+
+        outputKeys.insert (getKey (output));
+        settings.outputFiles.add (output);
+    }
+
+    return true;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    RenderSettings settings;
+
+    if (! parseArguments (juce::ArgumentList (argc, argv), settings))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (! resolveOutputFiles (settings))
+        return 1;
+
+    if (! settings.outputDirectory.createDirectory())
+    {
+        std::cerr << "Couldn't create " << settings.outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::atomic<int> nextFile { 0 };
+    std::atomic<int> numFailures { 0 };
+
+    juce::OwnedArray<RenderWorker> workers;
+    auto numWorkers = juce::jmin (settings.numThreads, settings.inputFiles.size());
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add (new RenderWorker (settings, nextFile, numFailures))->startThread();
+
+    double secondsRendered = 0.0;
+    int numFilesRendered = 0;
+    juce::int64 processingTicks = 0;
+    juce::int64 channelSamplesProcessed = 0;
+
+    for (auto* worker : workers)
+    {
+        worker->waitForThreadToExit (-1);
+        secondsRendered += worker->getSecondsRendered();
+        numFilesRendered += worker->getNumFilesRendered();
+        processingTicks += worker->getProcessingTicks();
+        channelSamplesProcessed += worker->getChannelSamplesProcessed();
+    }
+
+    auto elapsedSeconds = juce::jmax (1.0e-6, (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0);
+
+    std::cout << "Rendered " << numFilesRendered << " files (" << numFailures.load() << " failed) in "
+              << juce::String (elapsedSeconds, 2) << " s on " << numWorkers << " threads" << std::endl
+              << "  " << juce::String (numFilesRendered / elapsedSeconds, 2) << " files/sec, "
+              << juce::String (secondsRendered / elapsedSeconds, 1) << "x realtime" << std::endl;
+
+    auto nanosecondsPerSample = juce::Time::highResolutionTicksToSeconds (processingTicks) * 1.0e9
+                                  / (double) juce::jmax ((juce::int64) 1, channelSamplesProcessed);
+
+    // For information only - the per-path performance gate is the Tests target's --benchmark
+    std::cout << "  " << juce::String (nanosecondsPerSample, 2) << " ns per channel-sample in processBlock" << std::endl;
+
+    return numFailures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+/*
+  ==============================================================================
+
+    Realtime audit driver: runs DelayPlugInAudioProcessor, built with
+    DELAYPLUGIN_REALTIME_AUDIT=1, through random prepare/release cycles, block
+    sizes and parameter sweeps, and fails if processing audio ever allocated,
+    locked, made a blocking call or woke another thread.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#include <iostream>
+
+#if ! DELAYPLUGIN_REALTIME_AUDIT
+ #error "The realtime audit driver needs DELAYPLUGIN_REALTIME_AUDIT=1"
+#endif
+
+//==============================================================================
+struct AuditSettings
+{
+    juce::int64 seed = 1;
+    int numCycles = 40;
+    int blocksPerCycle = 400;
+    int maxReportedViolations = 10;
+};
+
+// A host clock whose tempo wanders, and that sometimes has nothing to report, as hosts do when stopped
+class SweepingPlayHead  : public juce::AudioPlayHead
+{
+public:
+    bool getCurrentPosition (CurrentPositionInfo& result) override
+    {
+        if (! hasPosition)
+            return false;
+
+        result = CurrentPositionInfo();
+        result.bpm = bpm;
+        return true;
+    }
+
+    double bpm = 120.0;
+    bool hasPosition = true;
+};
+
+//==============================================================================
+class RealtimeAuditDriver
+{
+public:
+    explicit RealtimeAuditDriver (const AuditSettings& s)
+        : settings (s), random (s.seed)
+    {
+        processor.setPlayHead (&playHead);
+    }
+
+    // Returns the number of violations seen
+    int run()
+    {
+        DelayPlugInAudioProcessor::resetRealtimeViolationCount();
+
+        for (cycle = 0; cycle < settings.numCycles; ++cycle)
+            runCycle();
+
+        auto numViolations = DelayPlugInAudioProcessor::getRealtimeViolationCount();
+
+        std::cout << "Ran " << settings.numCycles << " prepare/release cycles: " << numAuditedBlocks << " realtime blocks audited, "
+                  << numOfflineBlocks << " offline blocks not audited" << std::endl;
+
+        for (int kind = 0; kind < RealtimeAudit::numKinds; ++kind)
+        {
+            auto count = RealtimeAudit::getViolationCount ((RealtimeAudit::Kind) kind);
+
+            if (count > 0)
+                std::cout << "  " << count << " x " << RealtimeAudit::getKindName ((RealtimeAudit::Kind) kind)
+                          << ", last in " << RealtimeAudit::getLastViolation ((RealtimeAudit::Kind) kind) << std::endl;
+        }
+
+        std::cout << (numViolations == 0 ? juce::String ("No realtime violations")
+                                         : juce::String (numViolations) + " realtime violations") << std::endl;
+
+        return numViolations;
+    }
+
+private:
+    void runCycle()
+    {
+        prepare();
+
+        // Some hosts prepare again without releasing first, e.g. when the sample rate changes
+        auto reprepareAt = random.nextInt (3) == 0 ? random.nextInt (settings.blocksPerCycle) : -1;
+
+        for (block = 0; block < settings.blocksPerCycle; ++block)
+        {
+            if (block == reprepareAt)
+                prepare();
+
+            sweepParameters();
+            processNextBlock();
+        }
+
+        processor.releaseResources();
+    }
+
+    void prepare()
+    {
+        static const int channelCounts[] = { 1, 2, 6, 16 };
+        static const double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+        static const int maxBlockSizes[] = { 64, 256, 480, 1024, 4096 };
+
+        numChannels = channelCounts[random.nextInt (juce::numElementsInArray (channelCounts))];
+        sampleRate = sampleRates[random.nextInt (juce::numElementsInArray (sampleRates))];
+        maxBlockSize = maxBlockSizes[random.nextInt (juce::numElementsInArray (maxBlockSizes))];
+        nonRealtime = random.nextInt (4) == 0;
+
+        // Mostly on, so that wide buses get handed to the channel workers
+        findParameter ("multithread")->setValueNotifyingHost (random.nextInt (4) != 0 ? 1.0f : 0.0f);
+
+        auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (channelSet);
+        layout.outputBuses.add (channelSet);
+
+        auto layoutAccepted = processor.setBusesLayout (layout);
+        jassert (layoutAccepted);
+        juce::ignoreUnused (layoutAccepted);
+
+        processor.setRateAndBufferSizeDetails (sampleRate, maxBlockSize);
+        processor.setNonRealtime (nonRealtime);
+        processor.prepareToPlay (sampleRate, maxBlockSize);
+
+        // Allocated here, so that processNextBlock() only ever shrinks it
+        buffer.setSize (numChannels, maxBlockSize);
+    }
+
+    // Called between blocks, as a host's automation would be - every parameter drifts a little,
+    // and now and then jumps anywhere, which is how modes, note values and switches change
+    void sweepParameters()
+    {
+        for (auto* param : processor.getParameters())
+        {
+            auto value = random.nextInt (64) == 0 ? random.nextFloat()
+                                                  : param->getValue() + (random.nextFloat() - 0.5f) * 0.05f;
+
+            param->setValueNotifyingHost (juce::jlimit (0.0f, 1.0f, value));
+        }
+
+        playHead.bpm = juce::jlimit (30.0, 300.0, playHead.bpm + (random.nextFloat() - 0.5f) * 4.0);
+        playHead.hasPosition = random.nextInt (32) != 0;
+    }
+
+    void processNextBlock()
+    {
+        auto numSamples = chooseBlockSize();
+
+        buffer.setSize (numChannels, numSamples, false, false, true);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample (channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+        auto violationsBefore = DelayPlugInAudioProcessor::getRealtimeViolationCount();
+        int kindCountsBefore[RealtimeAudit::numKinds];
+
+        for (int kind = 0; kind < RealtimeAudit::numKinds; ++kind)
+            kindCountsBefore[kind] = RealtimeAudit::getViolationCount ((RealtimeAudit::Kind) kind);
+
+        processor.processBlock (buffer, midi);
+
+        if (nonRealtime)
+            ++numOfflineBlocks;
+        else
+            ++numAuditedBlocks;
+
+        if (DelayPlugInAudioProcessor::getRealtimeViolationCount() != violationsBefore)
+            reportViolation (numSamples, kindCountsBefore);
+    }
+
+    // Hosts do send empty and single-sample blocks, and full ones are the common case
+    int chooseBlockSize()
+    {
+        switch (random.nextInt (8))
+        {
+            case 0:  return 0;
+            case 1:  return 1;
+            case 2:  return maxBlockSize;
+            default: return random.nextInt (maxBlockSize + 1);
+        }
+    }
+
+    void reportViolation (int numSamples, const int* kindCountsBefore)
+    {
+        if (++numReportedViolations > settings.maxReportedViolations)
+            return;
+
+        auto* mode = findParameter ("mode");
+
+        std::cout << "Violation in cycle " << cycle << ", block " << block << ": " << numChannels << " channels at "
+                  << sampleRate << " Hz, " << numSamples << " samples (prepared for " << maxBlockSize << "), "
+                  << mode->getText (mode->getValue(), 32) << " mode" << std::endl;
+
+        for (int kind = 0; kind < RealtimeAudit::numKinds; ++kind)
+        {
+            auto count = RealtimeAudit::getViolationCount ((RealtimeAudit::Kind) kind) - kindCountsBefore[kind];
+
+            if (count > 0)
+                std::cout << "  " << count << " x " << RealtimeAudit::getKindName ((RealtimeAudit::Kind) kind)
+                          << ", last in " << RealtimeAudit::getLastViolation ((RealtimeAudit::Kind) kind) << std::endl;
+        }
+    }
+
+    juce::RangedAudioParameter* findParameter (const juce::String& parameterID) const
+    {
+        for (auto* param : processor.getParameters())
+            if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*> (param))
+                if (rangedParam->paramID == parameterID)
+                    return rangedParam;
+
+        jassertfalse;
+        return nullptr;
+    }
+
+    const AuditSettings& settings;
+    juce::Random random;
+
+    DelayPlugInAudioProcessor processor;
+    SweepingPlayHead playHead;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    int maxBlockSize = 0;
+    bool nonRealtime = false;
+
+    int cycle = 0;
+    int block = 0;
+    int numAuditedBlocks = 0;
+    int numOfflineBlocks = 0;
+    int numReportedViolations = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeAuditDriver)
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << "Usage: RealtimeAudit [options]" << std::endl
+              << std::endl
+              << "  --seed <n>      seed for the random cycles, blocks and sweeps (default 1)" << std::endl
+              << "  --cycles <n>    prepare/release cycles to run (default 40)" << std::endl
+              << "  --blocks <n>    blocks processed per cycle (default 400)" << std::endl
+              << std::endl
+              << "Exits with 1 if processing audio ever allocated, locked, slept or waited, touched a file, or started or woke a thread." << std::endl;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+    AuditSettings settings;
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption ("--seed"))
+        settings.seed = args.getValueForOption ("--seed").getLargeIntValue();
+
+    if (args.containsOption ("--cycles"))
+        settings.numCycles = juce::jmax (1, args.getValueForOption ("--cycles").getIntValue());
+
+    if (args.containsOption ("--blocks"))
+        settings.blocksPerCycle = juce::jmax (1, args.getValueForOption ("--blocks").getIntValue());
+
+    std::cout << "Seed " << settings.seed << std::endl;
+
+    RealtimeAuditDriver driver (settings);
+    return driver.run() == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    ChannelGroupPool.cpp
+
+  ==============================================================================
+*/
+
+#include "ChannelGroupPool.h"
+
+//==============================================================================
+ChannelGroupPool::Worker::Worker(ChannelGroupPool& pool)
+    : juce::Thread("Channel Group Worker"), mPool(pool)
+{
+}
+
+void ChannelGroupPool::Worker::run()
+{
+    int idleChecks = 0;
+    juce::uint32 idleSinceMs = 0;
+
+    while(! threadShouldExit()){
+
+        if(mPool.runNextGroup()){
+            idleChecks = 0;
+            continue;
+        }
+
+        //spin first, then give the core away, and once nothing has come for a while doze between checks
+        if(idleChecks < 2000){
+            if(++idleChecks == 2000){
+                idleSinceMs = juce::Time::getMillisecondCounter();
+            }
+
+            continue;
+        }
+
+        if(juce::Time::getMillisecondCounter() - idleSinceMs < yieldForMs){
+            juce::Thread::yield();
+            continue;
+        }
+
+        //the audio thread never wakes anyone, so the wait always times out - only stopThread() cuts it short
+        wait(mPool.areWorkersWanted() ? dozeMs : idleDozeMs);
+    }
+}
+
+//==============================================================================
+ChannelGroupPool::ChannelGroupPool()
+{
+    mFunction = nullptr;
+    mContext = nullptr;
+    mJob = 0;
+    mGroupsRemaining = 0;
+    mNumWorkers = 0;
+    mWantedAtMs = 0;
+}
+
+ChannelGroupPool::~ChannelGroupPool()
+{
+    release();
+}
+
+void ChannelGroupPool::prepare(int numWorkers)
+{
+    numWorkers = juce::jlimit(0, (int)maxWorkers, numWorkers);
+
+    //a worker stopped mid-job finishes its group first, and the audio thread claims whatever is left
+    while(mWorkers.size() > numWorkers){
+        mNumWorkers = mWorkers.size() - 1;
+        mWorkers.getLast()->stopThread(1000);
+        mWorkers.removeLast();
+    }
+
+    while(mWorkers.size() < numWorkers){
+        auto* worker = mWorkers.add(new Worker(*this));
+        worker->startThread(9); //just below the priority JUCE gives its own realtime threads
+        mNumWorkers = mWorkers.size();
+    }
+}
+
+void ChannelGroupPool::release()
+{
+    for(auto* worker : mWorkers){
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+
+    prepare(0);
+}
+
+int ChannelGroupPool::getNumWorkers() const
+{
+    return mNumWorkers.load(std::memory_order_relaxed);
+}
+
+void ChannelGroupPool::setWorkersWanted(bool wanted)
+{
+    //0 is kept for "not wanted", so a counter that has just wrapped round is moved on by a millisecond
+    mWantedAtMs.store(wanted ? juce::jmax((juce::uint32)1, juce::Time::getMillisecondCounter()) : 0, std::memory_order_relaxed);
+}
+
+bool ChannelGroupPool::areWorkersWanted() const
+{
+    const juce::uint32 wantedAtMs = mWantedAtMs.load(std::memory_order_relaxed);
+    return wantedAtMs != 0 && juce::Time::getMillisecondCounter() - wantedAtMs < yieldForMs;
+}
+
+void ChannelGroupPool::run(int numGroups, GroupFunction function, void* context)
+{
+    if(numGroups <= 0){
+        return;
+    }
+
+    mFunction = function;
+    mContext = context;
+    mGroupsRemaining.store(numGroups, std::memory_order_relaxed);
+    mJob.store((juce::uint32)numGroups << 16, std::memory_order_release);
+
+    //the audio thread works through groups too, then waits for any still running on a worker
+    while(runNextGroup()){
+    }
+
+    while(mGroupsRemaining.load(std::memory_order_acquire) > 0){
+    }
+}
+
+bool ChannelGroupPool::runNextGroup()
+{
+    juce::uint32 job = mJob.load(std::memory_order_acquire);
+
+    while(true){
+        const int numGroups = (int)(job >> 16);
+        const int group = (int)(job & 0xffff);
+
+        if(group >= numGroups){
+            return false;
+        }
+
+        if(mJob.compare_exchange_weak(job, job + 1, std::memory_order_acq_rel, std::memory_order_acquire)){
+            mFunction(mContext, group);
+            mGroupsRemaining.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    ChannelGroupPool.h
+
+    A small pool of worker threads that the audio thread hands groups of
+    channels to, for buses too wide for one core to get through in time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    The workers are started and stopped from prepare(), which must not run
+    while audio is being processed - the host doesn't call prepareToPlay() or
+    releaseResources() during processBlock(). run() publishes a job by storing
+    a single atomic word, then the audio thread claims groups alongside the
+    workers until every group is done, so it never allocates, locks, sleeps or
+    wakes another thread.
+
+    Idle workers spin for a short while so they are still awake for the next
+    block at small buffer sizes, then yield, and once nothing has come for
+    yieldForMs they doze in short timed waits. Nothing ever has to wake them:
+    while the audio thread keeps saying it wants them, through one atomic store
+    a block, they look for a job every dozeMs, otherwise only every idleDozeMs.
+    Groups no worker has picked up yet are simply run by the audio thread.
+*/
+class ChannelGroupPool
+{
+public:
+    using GroupFunction = void (*)(void* context, int groupIndex);
+
+    static constexpr int maxWorkers = 15;
+    static constexpr juce::uint32 yieldForMs = 100; //how long after the last job idle workers keep yielding
+    static constexpr int dozeMs = 1; //how often dozing workers look for a job while they're wanted...
+    static constexpr int idleDozeMs = 100; //...and while they aren't, or the audio thread hasn't said for yieldForMs
+
+    ChannelGroupPool();
+    ~ChannelGroupPool();
+
+    //starts or stops threads so that exactly numWorkers are running - not from the audio thread,
+    //and never while run() may be called
+    void prepare(int numWorkers);
+    void release();
+
+    int getNumWorkers() const;
+
+    //called by the audio thread once per block, whether or not it runs a job - keeps dozing workers
+    //checking for work every dozeMs, so they're back within a millisecond of being needed again
+    void setWorkersWanted(bool wanted);
+
+    //calls function once for every group index in [0, numGroups), spread over the
+    //workers and the calling thread, and returns when all of them have finished
+    void run(int numGroups, GroupFunction function, void* context);
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(ChannelGroupPool& pool);
+        void run() override;
+
+    private:
+        ChannelGroupPool& mPool;
+    };
+
+    //claims and runs one group of the current job, false if there were none left
+    bool runNextGroup();
+
+    //whether the audio thread has asked for the workers within the last yieldForMs
+    bool areWorkersWanted() const;
+
+    juce::OwnedArray<Worker> mWorkers; //only touched by prepare(), never while audio is being processed
+    std::atomic<int> mNumWorkers; //what the audio thread reads
+    std::atomic<juce::uint32> mWantedAtMs; //when the audio thread last wanted the workers, 0 when it didn't
+
+    //only written by run() before the job is published, and only read after a group is claimed
+    GroupFunction mFunction;
+    void* mContext;
+
+    //the number of groups in the high 16 bits and the next group to claim in the low 16 bits, claimed by
+    //compare-exchange on the whole word. That doesn't rule out ABA - a claimer can stall while its job finishes
+    //and a new one with the same group count reaches the same word - but such a claim is still correct, because
+    //run() only publishes after every group of the last job has finished, and a claim always takes the next
+    //unclaimed group of whichever job is current, reading mFunction and mContext only after it succeeds
+    std::atomic<juce::uint32> mJob;
+    std::atomic<int> mGroupsRemaining;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelGroupPool)
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+    GrainEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "GrainEngine.h"
+
+//==============================================================================
+GrainEngine::GrainEngine()
+{
+    mSampleRate = 0;
+    mNumActiveGrains = 0;
+    mMaxActiveGrains = maxGrains;
+    mSamplesUntilNextGrain = 0;
+
+    mDelayInSamples = 0;
+    mGrainSizeInSamples = 1;
+    mGrainInterval = 1;
+    mJitter = 0;
+    mPitchRatio = 1;
+    mReverse = false;
+    mOutputGain = 1;
+    mCubicInterpolation = false;
+
+    //Hann window, with one guard point so the table lookup can always read index + 1
+    mWindowTable.resize(windowTableSize + 1);
+
+    for(int i = 0; i <= windowTableSize; i++){
+        mWindowTable[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * i / windowTableSize);
+    }
+}
+
+void GrainEngine::prepare(double sampleRate)
+{
+    //grains already playing carry on over a re-prepare at the same rate
+    if(sampleRate == mSampleRate){
+        return;
+    }
+
+    mSampleRate = sampleRate;
+    reset();
+}
+
+void GrainEngine::reset()
+{
+    mNumActiveGrains = 0;
+    mSamplesUntilNextGrain = 0;
+    mRandom.setSeed(0x5eed); //same grain pattern on every render
+}
+
+void GrainEngine::setParameters(float delayInSamples, float grainSizeSeconds, float grainsPerSecond,
+                                float jitter, float pitchRatio, bool reverse, int bufferLength)
+{
+    mDelayInSamples = delayInSamples;
+    mJitter = jitter;
+    mPitchRatio = pitchRatio;
+    mReverse = reverse;
+
+    if(reverse){
+        //reverse delay: each grain plays the last delay-time's worth of audio backwards,
+        //with grains overlapping by half so the Hann windows sum to one. A grain reads back (1 + pitch) samples
+        //for every sample the write head moves on, so long delays are capped to what the buffer holds
+        mGrainSizeInSamples = juce::jlimit(2.0f, juce::jmax(2.0f, (bufferLength - 3.0f) / (1.0f + pitchRatio)), delayInSamples);
+        mGrainInterval = mGrainSizeInSamples * 0.5f;
+    }
+    else{
+        mGrainSizeInSamples = juce::jmax(2.0f, grainSizeSeconds * (float)mSampleRate);
+        mGrainInterval = juce::jmax(1.0f, (float)mSampleRate / grainsPerSecond);
+    }
+
+    //a Hann window averages 0.5, so scale down once grains start piling up
+    mOutputGain = 1.0f / juce::jmax(1.0f, 0.5f * mGrainSizeInSamples / mGrainInterval);
+}
+
+int GrainEngine::getMaxReadDistance(int bufferLength) const
+{
+    //spawnGrain() only ever shortens grains and pulls their start in, so this bounds every grain it spawns
+    double distance;
+
+    if(mReverse){
+        distance = mGrainSizeInSamples * (1.0 + mPitchRatio);
+    }
+    else{
+        const double nearest = juce::jmax(0.0f, mGrainSizeInSamples * (mPitchRatio - 1.0f)) + 2.0;
+        const double start = juce::jmax(nearest, (double)mDelayInSamples + mJitter * mGrainSizeInSamples);
+        distance = start + juce::jmax(0.0f, mGrainSizeInSamples * (1.0f - mPitchRatio));
+    }
+
+    //the point before the read position, and the one being rounded down to
+    return juce::jmin(bufferLength, (int)std::ceil(distance) + 2);
+}
+
+void GrainEngine::setMaxActiveGrains(int numGrains)
+{
+    mMaxActiveGrains = juce::jlimit(1, (int)maxGrains, numGrains);
+}
+
+void GrainEngine::spawnGrain(int writeHead, int bufferLength)
+{
+    if(mNumActiveGrains >= mMaxActiveGrains){
+        return;
+    }
+
+    //how far the grain's distance from the write head changes over its life - it has to stay inside the buffer
+    //the whole way, so long grains at extreme pitches are shortened until they fit
+    const float driftPerSample = mReverse ? 1.0f + mPitchRatio : std::abs(mPitchRatio - 1.0f);
+    float grainSize = mGrainSizeInSamples;
+
+    if(driftPerSample * grainSize > bufferLength - 3.0f){
+        grainSize = juce::jmax(2.0f, (bufferLength - 3.0f) / driftPerSample);
+    }
+
+    float startDistance = 0; //how far behind the write head the grain starts
+
+    if(! mReverse){
+        //a grain playing faster than unity creeps towards the write head, and a slower one falls back
+        //towards the oldest sample, so leave room for whichever way it drifts
+        const float nearest = juce::jmax(0.0f, grainSize * (mPitchRatio - 1.0f)) + 2.0f;
+        const float furthest = bufferLength - 2.0f - juce::jmax(0.0f, grainSize * (1.0f - mPitchRatio));
+
+        startDistance = mDelayInSamples + mJitter * mRandom.nextFloat() * mGrainSizeInSamples;
+        startDistance = juce::jlimit(nearest, juce::jmax(nearest, furthest), startDistance);
+    }
+
+    //reverse grains start at the newest sample and read back through the buffer
+    double startPosition = writeHead - (double)startDistance;
+
+    if(startPosition < 0){
+        startPosition += bufferLength;
+    }
+
+    int grain = mNumActiveGrains++;
+    mGrainPosition[grain] = startPosition;
+    mGrainIncrement[grain] = mReverse ? -mPitchRatio : mPitchRatio;
+    mGrainWindowPhase[grain] = 0;
+    mGrainWindowIncrement[grain] = 1.0f / grainSize;
+}
+
+void GrainEngine::renderSample(const float* const* buffers, int numChannels, int bufferLength, int writeHead,
+                               float* outputs)
+{
+    mSamplesUntilNextGrain -= 1.0f;
+
+    if(mSamplesUntilNextGrain <= 0){
+        spawnGrain(writeHead, bufferLength);
+        mSamplesUntilNextGrain += mGrainInterval * (1.0f + mJitter * (mRandom.nextFloat() - 0.5f));
+    }
+
+    for(int channel = 0; channel < numChannels; channel++){
+        outputs[channel] = 0;
+    }
+
+    if(mCubicInterpolation){
+        accumulateGrains<true>(buffers, numChannels, bufferLength, outputs);
+    }
+    else{
+        accumulateGrains<false>(buffers, numChannels, bufferLength, outputs);
+    }
+
+    //retire finished grains by moving the last active grain into their slot
+    for(int grain = mNumActiveGrains - 1; grain >= 0; grain--){
+        if(mGrainWindowPhase[grain] >= 1.0f){
+            int last = --mNumActiveGrains;
+            mGrainPosition[grain] = mGrainPosition[last];
+            mGrainIncrement[grain] = mGrainIncrement[last];
+            mGrainWindowPhase[grain] = mGrainWindowPhase[last];
+            mGrainWindowIncrement[grain] = mGrainWindowIncrement[last];
+        }
+    }
+
+    for(int channel = 0; channel < numChannels; channel++){
+        outputs[channel] *= mOutputGain;
+    }
+}
+
+template <bool Cubic>
+void GrainEngine::accumulateGrains(const float* const* buffers, int numChannels, int bufferLength, float* outputs)
+{
+    const double bufferLengthDouble = (double)bufferLength;
+
+    for(int grain = 0; grain < mNumActiveGrains; grain++){
+
+        float windowIndex = mGrainWindowPhase[grain] * windowTableSize;
+        int window_x = (int)windowIndex;
+        float window = mWindowTable[window_x] + (windowIndex - window_x) * (mWindowTable[window_x + 1] - mWindowTable[window_x]);
+
+        double position = mGrainPosition[grain];
+        int readHead_x = (int)position;
+        int readHead_x1 = readHead_x + 1 == bufferLength ? 0 : readHead_x + 1;
+        float readHeadFloat = (float)(position - readHead_x);
+
+        if(Cubic){
+            //forward grains are spawned two samples clear of the write head, so the outer points are written audio -
+            //reverse grains start right on it, but their window is still closed while they're that close
+            int readHead_xm1 = readHead_x == 0 ? bufferLength - 1 : readHead_x - 1;
+            int readHead_x2 = readHead_x1 + 1 == bufferLength ? 0 : readHead_x1 + 1;
+
+            for(int channel = 0; channel < numChannels; channel++){
+                const float* buffer = buffers[channel];
+
+                //4-point, 3rd-order Hermite (Catmull-Rom), as in the delay kernel
+                float c1 = 0.5f * (buffer[readHead_x1] - buffer[readHead_xm1]);
+                float c2 = buffer[readHead_xm1] - 2.5f * buffer[readHead_x] + 2.0f * buffer[readHead_x1] - 0.5f * buffer[readHead_x2];
+                float c3 = 0.5f * (buffer[readHead_x2] - buffer[readHead_xm1]) + 1.5f * (buffer[readHead_x] - buffer[readHead_x1]);
+
+                outputs[channel] += window * (((c3 * readHeadFloat + c2) * readHeadFloat + c1) * readHeadFloat + buffer[readHead_x]);
+            }
+        }
+        else{
+            for(int channel = 0; channel < numChannels; channel++){
+                const float* buffer = buffers[channel];
+                outputs[channel] += window * (buffer[readHead_x] + readHeadFloat * (buffer[readHead_x1] - buffer[readHead_x]));
+            }
+        }
+
+        position += mGrainIncrement[grain];
+
+        if(position < 0){
+            position += bufferLengthDouble;
+        }
+        else if(position >= bufferLengthDouble){
+            position -= bufferLengthDouble;
+        }
+
+        mGrainPosition[grain] = position;
+        mGrainWindowPhase[grain] += mGrainWindowIncrement[grain];
+    }
+}
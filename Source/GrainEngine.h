@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    GrainEngine.h
+
+    Reads windowed grains out of the plugin's circular buffers, either
+    backwards (reverse delay) or forwards at a pitch-shifted rate (granular).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+/**
+    Grains come from a fixed-capacity pool that is never resized, and their
+    state is kept as structure-of-arrays so the per-sample loop over the active
+    grains walks contiguous memory. Each grain reads from its own place in the
+    delay lines, so the reads are gathers and the loop itself stays scalar.
+    Read positions are doubles, so pitched grains keep their rate even deep
+    into a long buffer. The window shape is a precomputed table. Grains read
+    with linear interpolation, or 4-point Hermite for offline renders.
+*/
+class GrainEngine
+{
+public:
+    static constexpr int maxGrains = 64;
+    static constexpr int windowTableSize = 1024;
+
+    GrainEngine();
+
+    void prepare(double sampleRate);
+    void reset();
+
+    //called once per block, bufferLength is the length of the circular buffers the grains read from
+    void setParameters(float delayInSamples, float grainSizeSeconds, float grainsPerSecond,
+                       float jitter, float pitchRatio, bool reverse, int bufferLength);
+
+    //caps how many grains may play at once, up to maxGrains - grains already playing finish normally
+    void setMaxActiveGrains(int numGrains);
+
+    //Hermite instead of linear interpolation between buffer samples, for the offline render profile
+    void setCubicInterpolation(bool shouldUseCubic) { mCubicInterpolation = shouldUseCubic; }
+    int getNumActiveGrains() const { return mNumActiveGrains; }
+
+    //furthest behind the write head a grain spawned with the current parameters reads over its life,
+    //interpolation points included, at most bufferLength
+    int getMaxReadDistance(int bufferLength) const;
+
+    //renders one output sample per channel into outputs, from grains reading the circular buffers -
+    //every channel shares the same grains so the image stays intact
+    void renderSample(const float* const* buffers, int numChannels, int bufferLength, int writeHead,
+                      float* outputs);
+
+private:
+    void spawnGrain(int writeHead, int bufferLength);
+
+    //adds every active grain's windowed sample to outputs and moves the grains on
+    template <bool Cubic>
+    void accumulateGrains(const float* const* buffers, int numChannels, int bufferLength, float* outputs);
+
+    double mSampleRate;
+
+    double mGrainPosition[maxGrains]; //read position in the circular buffer
+    double mGrainIncrement[maxGrains]; //negative when reversed
+    float mGrainWindowPhase[maxGrains];
+    float mGrainWindowIncrement[maxGrains];
+    int mNumActiveGrains; //active grains are kept packed at the front of the arrays
+    int mMaxActiveGrains;
+
+    std::vector<float> mWindowTable;
+
+    juce::Random mRandom;
+    float mSamplesUntilNextGrain;
+
+    float mDelayInSamples;
+    float mGrainSizeInSamples;
+    float mGrainInterval;
+    float mJitter;
+    float mPitchRatio;
+    bool mReverse;
+    float mOutputGain;
+    bool mCubicInterpolation;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GrainEngine)
+};
@@ -15,7 +15,7 @@ DelayPlugInAudioProcessorEditor::DelayPlugInAudioProcessorEditor (DelayPlugInAud
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (700, 550);
     
     auto& params = processor.getParameters(); //Reference to the parameters
     
@@ -119,12 +119,178 @@ DelayPlugInAudioProcessorEditor::DelayPlugInAudioProcessorEditor (DelayPlugInAud
     mDelayTimeLabel.attachToComponent(&mDelayTimeSlider, true);
     mDelayTimeLabel.setColour(juce::Label::textColourId, juce::Colour(219,254,25));
     
+    //==============================================================================
+    
+    //Spectral tilt control
+    
+    addRotarySlider(mSpectralTiltSlider, mSpectralTiltLabel, (juce::AudioParameterFloat*)params.getUnchecked(4), "Spectral Tilt", 100, 300);
+    
+    //==============================================================================
+    
+    //Grain controls, used by the reverse and granular modes
+    
+    addRotarySlider(mGrainSizeSlider, mGrainSizeLabel, (juce::AudioParameterFloat*)params.getUnchecked(5), "Grain Size", 450, 0);
+    addRotarySlider(mGrainDensitySlider, mGrainDensityLabel, (juce::AudioParameterFloat*)params.getUnchecked(6), "Density", 450, 100);
+    addRotarySlider(mGrainJitterSlider, mGrainJitterLabel, (juce::AudioParameterFloat*)params.getUnchecked(7), "Jitter", 450, 200);
+    addRotarySlider(mGrainPitchSlider, mGrainPitchLabel, (juce::AudioParameterFloat*)params.getUnchecked(8), "Pitch", 450, 300);
+    
+    //==============================================================================
+    
+    //Mode selector
+    
+    juce::AudioParameterChoice* modeParameter = ((juce::AudioParameterChoice*)params.getUnchecked(3));
+
+    mModeBox.setBounds(100, 405, 200, 24);
+    mModeBox.addItemList(modeParameter->choices, 1);
+    mModeBox.setSelectedItemIndex(*modeParameter, juce::dontSendNotification);
+    addAndMakeVisible(mModeBox);
+
+    mModeBox.onChange = [this, modeParameter]
+    {
+        modeParameter->beginChangeGesture();
+        *modeParameter = mModeBox.getSelectedItemIndex();
+        modeParameter->endChangeGesture();
+    };
+
+    addAndMakeVisible(mModeLabel);
+    mModeLabel.setText("Mode", juce::dontSendNotification);
+    mModeLabel.attachToComponent(&mModeBox, true);
+    mModeLabel.setColour(juce::Label::textColourId, juce::Colour(219,254,25));
+    
+    //==============================================================================
+    
+    //CPU governor switch and status
+    
+    juce::AudioParameterBool* governorParameter = ((juce::AudioParameterBool*)params.getUnchecked(9));
+    
+    mGovernorButton.setBounds(100, 445, 200, 24);
+    mGovernorButton.setColour(juce::ToggleButton::textColourId, juce::Colour(219,254,25));
+    mGovernorButton.setToggleState(*governorParameter, juce::dontSendNotification);
+    addAndMakeVisible(mGovernorButton);
+    
+    mGovernorButton.onClick = [this, governorParameter]
+    {
+        governorParameter->beginChangeGesture();
+        *governorParameter = mGovernorButton.getToggleState();
+        governorParameter->endChangeGesture();
+    };
+    
+    //==============================================================================
+    
+    //Channel group multithreading switch, only takes effect on buses of 8 channels or more
+    
+    juce::AudioParameterBool* multithreadParameter = ((juce::AudioParameterBool*)params.getUnchecked(10));
+    
+    mMultithreadButton.setBounds(100, 480, 200, 24);
+    mMultithreadButton.setColour(juce::ToggleButton::textColourId, juce::Colour(219,254,25));
+    mMultithreadButton.setToggleState(*multithreadParameter, juce::dontSendNotification);
+    addAndMakeVisible(mMultithreadButton);
+    
+    mMultithreadButton.onClick = [this, multithreadParameter]
+    {
+        multithreadParameter->beginChangeGesture();
+        *multithreadParameter = mMultithreadButton.getToggleState();
+        multithreadParameter->endChangeGesture();
+    };
+    
+    //==============================================================================
+    
+    //Tempo sync - the note value takes over from the delay time control while it's on
+    
+    juce::AudioParameterBool* syncParameter = ((juce::AudioParameterBool*)params.getUnchecked(11));
+    juce::AudioParameterChoice* noteValueParameter = ((juce::AudioParameterChoice*)params.getUnchecked(12));
+    
+    mSyncButton.setBounds(350, 405, 80, 24);
+    mSyncButton.setColour(juce::ToggleButton::textColourId, juce::Colour(219,254,25));
+    mSyncButton.setToggleState(*syncParameter, juce::dontSendNotification);
+    addAndMakeVisible(mSyncButton);
+    
+    mDelayTimeSlider.setEnabled(! *syncParameter);
+    
+    mSyncButton.onClick = [this, syncParameter]
+    {
+        syncParameter->beginChangeGesture();
+        *syncParameter = mSyncButton.getToggleState();
+        syncParameter->endChangeGesture();
+        
+        mDelayTimeSlider.setEnabled(! mSyncButton.getToggleState());
+    };
+    
+    mNoteValueBox.setBounds(450, 405, 200, 24);
+    mNoteValueBox.addItemList(noteValueParameter->choices, 1);
+    mNoteValueBox.setSelectedItemIndex(*noteValueParameter, juce::dontSendNotification);
+    addAndMakeVisible(mNoteValueBox);
+    
+    mNoteValueBox.onChange = [this, noteValueParameter]
+    {
+        noteValueParameter->beginChangeGesture();
+        *noteValueParameter = mNoteValueBox.getSelectedItemIndex();
+        noteValueParameter->endChangeGesture();
+    };
+    
+    //==============================================================================
+    
+    //Spectral hop size, the CPU governor doubles it when it steps down
+    
+    juce::AudioParameterChoice* spectralHopParameter = ((juce::AudioParameterChoice*)params.getUnchecked(13));
+    
+    mSpectralHopBox.setBounds(100, 515, 200, 24);
+    mSpectralHopBox.addItemList(spectralHopParameter->choices, 1);
+    mSpectralHopBox.setSelectedItemIndex(*spectralHopParameter, juce::dontSendNotification);
+    addAndMakeVisible(mSpectralHopBox);
+    
+    mSpectralHopBox.onChange = [this, spectralHopParameter]
+    {
+        spectralHopParameter->beginChangeGesture();
+        *spectralHopParameter = mSpectralHopBox.getSelectedItemIndex();
+        spectralHopParameter->endChangeGesture();
+    };
+    
+    addAndMakeVisible(mSpectralHopLabel);
+    mSpectralHopLabel.setText("Hop", juce::dontSendNotification);
+    mSpectralHopLabel.attachToComponent(&mSpectralHopBox, true);
+    mSpectralHopLabel.setColour(juce::Label::textColourId, juce::Colour(219,254,25));
+    
+    startTimerHz(4);
+    
 }
 
 DelayPlugInAudioProcessorEditor::~DelayPlugInAudioProcessorEditor()
 {
 }
 
+void DelayPlugInAudioProcessorEditor::addRotarySlider(juce::Slider& slider, juce::Label& label, juce::AudioParameterFloat* parameter,
+                                                      const juce::String& name, int x, int y)
+{
+    slider.setBounds(x, y, 200, 100);
+    slider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+    slider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+    slider.setColour(juce::Slider::thumbColourId, juce::Colour(219,254,25));
+    slider.setRange(parameter->range.start, parameter->range.end);
+    slider.setValue(*parameter);
+    addAndMakeVisible(slider);
+    
+    slider.onValueChange = [&slider, parameter]
+    {
+        *parameter = slider.getValue();
+    };
+    
+    slider.onDragStart = [parameter]
+    {
+        parameter->beginChangeGesture();
+    };
+    
+    slider.onDragEnd = [parameter]
+    {
+        parameter->endChangeGesture();
+    };
+    
+    addAndMakeVisible(label);
+    label.setText(name, juce::dontSendNotification);
+    label.attachToComponent(&slider, true);
+    label.setColour(juce::Label::textColourId, juce::Colour(219,254,25));
+}
+
 //==============================================================================
 void DelayPlugInAudioProcessorEditor::paint (juce::Graphics& g)
 {
@@ -133,6 +299,32 @@ void DelayPlugInAudioProcessorEditor::paint (juce::Graphics& g)
     g.setColour (juce::Colours::white);
     g.setFont (15.0f);
     g.drawFittedText ("", getLocalBounds(), juce::Justification::centred, 1);
+    
+    g.setColour (juce::Colour(219,254,25));
+    g.drawFittedText (mGovernorStatus, 350, 440, 340, 85, juce::Justification::topLeft, 5);
+}
+
+void DelayPlugInAudioProcessorEditor::timerCallback()
+{
+    static const char* const tierNames[] = { "full", "reduced", "minimal" };
+    
+    const QualityGovernor& governor = audioProcessor.getQualityGovernor();
+    
+    juce::String status;
+    status << "Quality: " << tierNames[governor.getTier()]
+           << " (load " << juce::roundToInt(governor.getAverageLoad() * 100.0f) << "%)";
+    
+    const juce::uint32 now = juce::Time::getMillisecondCounter();
+    
+    for(int i = 0; i < governor.getNumSwitches(); i++){
+        QualityGovernor::Switch change = governor.getSwitch(i);
+        status << "\n" << tierNames[change.tier] << ", " << juce::String((now - change.timeMs) / 1000.0, 1) << "s ago";
+    }
+    
+    if(status != mGovernorStatus){
+        mGovernorStatus = status;
+        repaint();
+    }
 }
 
 void DelayPlugInAudioProcessorEditor::resized()
@@ -14,7 +14,8 @@
 //==============================================================================
 /**
 */
-class DelayPlugInAudioProcessorEditor  : public juce::AudioProcessorEditor
+class DelayPlugInAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                         private juce::Timer
 {
 public:
     DelayPlugInAudioProcessorEditor (DelayPlugInAudioProcessor&);
@@ -26,13 +27,43 @@ public:
 
 private:
     
+    void timerCallback() override; //refreshes the CPU governor status
+    
+    //sets up a rotary slider bound to a float parameter, with its label attached on the left
+    void addRotarySlider(juce::Slider& slider, juce::Label& label, juce::AudioParameterFloat* parameter,
+                         const juce::String& name, int x, int y);
+    
     juce::Slider mDryWetSlider;
     juce::Slider mFeedbackSlider;
     juce::Slider mDelayTimeSlider;
+    juce::Slider mSpectralTiltSlider;
+    juce::Slider mGrainSizeSlider;
+    juce::Slider mGrainDensitySlider;
+    juce::Slider mGrainJitterSlider;
+    juce::Slider mGrainPitchSlider;
+    
+    juce::ComboBox mModeBox;
+    
+    juce::ToggleButton mGovernorButton { "CPU Governor" };
+    juce::String mGovernorStatus;
+    
+    juce::ToggleButton mMultithreadButton { "Multithreaded Channels" };
+    
+    juce::ToggleButton mSyncButton { "Sync" };
+    juce::ComboBox mNoteValueBox;
+    
+    juce::ComboBox mSpectralHopBox;
     
     juce::Label mDryWetLabel;
     juce::Label mFeedbackLabel;
     juce::Label mDelayTimeLabel;
+    juce::Label mSpectralTiltLabel;
+    juce::Label mGrainSizeLabel;
+    juce::Label mGrainDensityLabel;
+    juce::Label mGrainJitterLabel;
+    juce::Label mGrainPitchLabel;
+    juce::Label mModeLabel;
+    juce::Label mSpectralHopLabel;
 
     
     // This reference is provided as a quick way for your editor to
@@ -9,6 +9,46 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+#if DELAYPLUGIN_REALTIME_AUDIT
+int DelayPlugInAudioProcessor::getRealtimeViolationCount()    { return RealtimeAudit::getViolationCount(); }
+void DelayPlugInAudioProcessor::resetRealtimeViolationCount() { RealtimeAudit::resetViolationCounts(); }
+#endif
+
+//==============================================================================
+namespace
+{
+    //the note values offered for tempo sync - each comes as a triplet, straight and dotted choice, and up to
+    //4 straight bars of 4/4 have to fit in MAX_SYNC_DELAY_TIME at MIN_SYNC_TEMPO
+    struct NoteValue
+    {
+        const char* name;
+        double quarterNotes;
+        int bars; //bar-based values depend on the time signature
+    };
+    
+    static const NoteValue noteValues[] =
+    {
+        { "1/64", 0.0625, 0 }, { "1/32", 0.125, 0 }, { "1/16", 0.25, 0 }, { "1/8", 0.5, 0 }, { "1/4", 1.0, 0 }, { "1/2", 2.0, 0 },
+        { "1 Bar", 0.0, 1 }, { "2 Bars", 0.0, 2 }, { "4 Bars", 0.0, 4 }
+    };
+    
+    static const double noteModifiers[] = { 2.0 / 3.0, 1.0, 1.5 };
+    static const char* const noteModifierNames[] = { " Triplet", "", " Dotted" };
+    
+    static juce::StringArray getNoteValueNames()
+    {
+        juce::StringArray names;
+        
+        for(auto& noteValue : noteValues){
+            for(auto* modifierName : noteModifierNames){
+                names.add(juce::String(noteValue.name) + modifierName);
+            }
+        }
+        
+        return names;
+    }
+}
+
 //==============================================================================
 DelayPlugInAudioProcessor::DelayPlugInAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -28,15 +68,47 @@ DelayPlugInAudioProcessor::DelayPlugInAudioProcessor()
     addParameter(mFeedbackParameter = new juce::AudioParameterFloat("feedback", "Feedback", 0.0f, 0.98, 0.0f));
     
     addParameter(mDelayTimeParameter = new juce::AudioParameterFloat("delayTime", "Delay Time", 0.1f, MAX_DELAY_TIME, 0.1f));
+    
+    addParameter(mModeParameter = new juce::AudioParameterChoice("mode", "Mode", juce::StringArray("Delay", "Spectral", "Reverse", "Granular"), 0));
+    
+    addParameter(mSpectralTiltParameter = new juce::AudioParameterFloat("spectralTilt", "Spectral Tilt", -1.0f, 1.0f, 0.0f));
+    
+    addParameter(mGrainSizeParameter = new juce::AudioParameterFloat("grainSize", "Grain Size", 0.01f, 0.5f, 0.1f));
+    
+    addParameter(mGrainDensityParameter = new juce::AudioParameterFloat("grainDensity", "Grain Density", 1.0f, 100.0f, 20.0f));
+    
+    addParameter(mGrainJitterParameter = new juce::AudioParameterFloat("grainJitter", "Grain Jitter", 0.0f, 1.0f, 0.0f));
+    
+    addParameter(mGrainPitchParameter = new juce::AudioParameterFloat("grainPitch", "Grain Pitch", 0.5f, 2.0f, 1.0f));
+    
+    addParameter(mGovernorParameter = new juce::AudioParameterBool("governor", "CPU Governor", false));
+    
+    addParameter(mMultithreadParameter = new juce::AudioParameterBool("multithread", "Multithreaded Channels", false));
+    
+    addParameter(mSyncParameter = new juce::AudioParameterBool("sync", "Tempo Sync", false));
+    
+    addParameter(mNoteValueParameter = new juce::AudioParameterChoice("noteValue", "Note Value", getNoteValueNames(), 13)); //1/4
+    
+    //shorter hops smear transients less and cost more FFTs per second - the choices are multiples of SPECTRAL_MIN_HOP_SIZE
+    addParameter(mSpectralHopParameter = new juce::AudioParameterChoice("spectralHop", "Spectral Hop", juce::StringArray("128", "256", "512"), 1));
         
     mDelayTimeSmoothed = 0;
     mCircularBufferWriteHead = 0;
-    mDelayReadHead = 0;
     mCircularBufferLength = 0;
-    mDelayTimeInSamples = 0;
+    mCircularBufferZeroedFrom = 0;
+    
+    mHostBpm = 120;
+    mHostTimeSigNumerator = 4;
+    mHostTimeSigDenominator = 4;
     
-    mFeedbackLeft = 0;
-    mFeedbackRight = 0;
+    mBlockChannels = nullptr;
+    mBlockDelayLines = nullptr;
+    mBlockSamples = 0;
+    mBlockNumChannels = 0;
+    mBlockNumGroups = 0;
+    mBlockSettings = DelayBlockSettings();
+    mBlockKernel = nullptr;
+    mBlockJob = nullptr;
     
 }
 
@@ -79,7 +151,29 @@ bool DelayPlugInAudioProcessor::isMidiEffect() const
 
 double DelayPlugInAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    //the longest echo, repeated until the feedback has taken it 60dB down
+    const int mode = mModeParameter->getIndex();
+    double delayTime = getTargetDelayTime();
+    double feedback = *mFeedbackParameter;
+    
+    if(mode == 1){
+        //the spectral tilt can double a bin's delay and raise its feedback by half
+        const double tilt = std::abs(*mSpectralTiltParameter);
+        delayTime = juce::jmin(delayTime * std::exp2(tilt), (double)MAX_SPECTRAL_DELAY_TIME);
+        feedback = juce::jmin(0.98, feedback * (1.0 + 0.5 * tilt));
+    }
+    else if(mode >= 2){
+        //a grain can start its own length behind the delay time, and then plays for that long
+        delayTime += 2.0 * *mGrainSizeParameter;
+    }
+    
+    double repeats = 1.0;
+    
+    if(feedback > 0.0){
+        repeats += std::ceil(std::log(0.001) / std::log(feedback));
+    }
+    
+    return juce::jmin((double)MAX_TAIL_TIME, delayTime * repeats);
 }
 
 int DelayPlugInAudioProcessor::getNumPrograms()
@@ -109,16 +203,46 @@ void DelayPlugInAudioProcessor::changeProgramName (int index, const juce::String
 //==============================================================================
 void DelayPlugInAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    mDelayTimeInSamples = sampleRate * *mDelayTimeParameter;
+    const int numChannels = juce::jlimit(1, MAX_CHANNELS, getTotalNumOutputChannels());
+    //the read head never gets closer than the guard to wrapping round onto the sample just written
+    const int circularBufferLength = (int)std::ceil(sampleRate * MAX_DELAY_LINE_TIME) + DELAY_LINE_GUARD_SAMPLES;
     
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+    //hosts re-prepare on every transport restart and block size change, so unless the delay lines
+    //change shape their memory, contents and write head are all kept
+    const bool delayLinesChanged = numChannels != mCircularBuffer.getNumChannels() || circularBufferLength != mCircularBufferLength;
     
-    mCircularBufferLeft.resize(mCircularBufferLength);
-    mCircularBufferRight.resize(mCircularBufferLength);
-
-    mCircularBufferWriteHead = 0;
+    if(delayLinesChanged){
+        mCircularBufferLength = circularBufferLength;
+        
+        //reuses the allocation when it's big enough and leaves it uncleared - reset() below marks the
+        //lines as unwritten, and only the parts that get read are zeroed, see clearUnwrittenDelayLines()
+        mCircularBuffer.setSize(numChannels, mCircularBufferLength, false, false, true);
+        mFeedback.resize(numChannels);
+    }
+    
+    while(mSpectralDelays.size() < numChannels){
+        mSpectralDelays.add(new SpectralDelay());
+    }
+    
+    mSpectralDelays.removeLast(mSpectralDelays.size() - numChannels);
+    
+    for(auto* spectralDelay : mSpectralDelays){
+        spectralDelay->prepare(sampleRate, SPECTRAL_FFT_ORDER, SPECTRAL_MIN_HOP_SIZE, MAX_SPECTRAL_DELAY_TIME);
+    }
+    
+    mGrainEngine.prepare(sampleRate);
     
-    mDelayTimeSmoothed = *mDelayTimeParameter;
+    mQualityGovernor.prepare(sampleRate);
+    
+    //offline bounces always start from silence, so they render the same every time
+    if(delayLinesChanged || isNonRealtime()){
+        reset();
+    }
+    
+    //workers are only worth having when each of them, and the audio thread, can be given a full group of channels.
+    //They're only ever started and stopped here, never while processing - the multithreading switch can be flipped
+    //while playing, so on wide buses they're there either way, and just doze while it's off
+    mChannelGroupPool.prepare(juce::jmax(0, juce::jmin(juce::SystemStats::getNumCpus() - 1, numChannels / MIN_CHANNELS_PER_GROUP - 1)));
     
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
@@ -128,6 +252,48 @@ void DelayPlugInAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    mChannelGroupPool.release();
+}
+
+void DelayPlugInAudioProcessor::reset()
+{
+    //the delay lines aren't cleared here, just marked as unwritten
+    mCircularBufferWriteHead = 0;
+    mCircularBufferZeroedFrom = mCircularBufferLength;
+    
+    std::fill(mFeedback.begin(), mFeedback.end(), 0.0f);
+    
+    mDelayTimeSmoothed = getTargetDelayTime();
+    
+    for(auto* spectralDelay : mSpectralDelays){
+        spectralDelay->reset();
+    }
+    
+    mGrainEngine.reset();
+}
+
+void DelayPlugInAudioProcessor::clearUnwrittenDelayLines(int lookbackSamples, int samples)
+{
+    //everything behind the write head has been written since the last reset, so the only stale memory a read can
+    //reach is the unwritten top of the lines, when it looks further back than the write head has come
+    if(mCircularBufferZeroedFrom == 0){
+        return;
+    }
+    
+    const int firstRead = juce::jmax(mCircularBufferWriteHead, mCircularBufferLength - (lookbackSamples - mCircularBufferWriteHead));
+    
+    if(firstRead < mCircularBufferZeroedFrom){
+        for(int channel = 0; channel < mCircularBuffer.getNumChannels(); channel++){
+            juce::FloatVectorOperations::clear(mCircularBuffer.getWritePointer(channel, firstRead), mCircularBufferZeroedFrom - firstRead);
+        }
+        
+        mCircularBufferZeroedFrom = firstRead;
+    }
+    
+    //once this block has written up to the zeroed part, the whole line holds real data
+    if(mCircularBufferWriteHead + samples >= mCircularBufferZeroedFrom){
+        mCircularBufferZeroedFrom = 0;
+    }
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -137,10 +303,10 @@ bool DelayPlugInAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel gets its own delay line, so any layout works - mono, stereo,
+    // surround, ambisonic or discrete - up to MAX_CHANNELS wide.
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || layouts.getMainOutputChannels() > MAX_CHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -156,6 +322,10 @@ bool DelayPlugInAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
 
 void DelayPlugInAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+   #if DELAYPLUGIN_REALTIME_AUDIT
+    RealtimeAudit::ScopedProcessBlock realtimeAudit(! isNonRealtime()); //offline renders have no deadline
+   #endif
+    
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -169,50 +339,407 @@ void DelayPlugInAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    float* leftChannel = buffer.getWritePointer(0); //Returns a writeable pointer to the buffer's left channel
-    float* rightChannel = buffer.getWritePointer(1); //Returns a writeable pointer to the buffer's right channel
+    //every block keeps the channel workers looking for jobs while the switch is on, even in the modes that don't
+    //hand them any, so they're there as soon as one does - a single atomic store, nobody is woken
+    mChannelGroupPool.setWorkersWanted(*mMultithreadParameter);
     
     auto samples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), mCircularBuffer.getNumChannels());
     
-    //loops through the samples in the buffer
-    for(int i = 0; i < samples; i++){
+    //nothing to do for empty blocks, or if the host hasn't called prepareToPlay yet
+    if(samples == 0 || numChannels == 0 || mCircularBufferLength == 0){
+        return;
+    }
+    
+    //tempo and time signature for note-value sync, read once per block - tempo ramps reach the delay time
+    //through the same one-pole smoothing as the delay time control, in every mode
+    if(auto* playHead = getPlayHead()){
+        juce::AudioPlayHead::CurrentPositionInfo position;
         
-        mDelayTimeSmoothed = mDelayTimeSmoothed - 0.001 * (mDelayTimeSmoothed - *mDelayTimeParameter);
-        mDelayTimeInSamples = getSampleRate() * mDelayTimeSmoothed;
+        if(playHead->getCurrentPosition(position) && position.bpm > 0){
+            mHostBpm = position.bpm;
+            
+            //some hosts leave the time signature empty, which keeps the last one
+            if(position.timeSigNumerator > 0 && position.timeSigDenominator > 0){
+                mHostTimeSigNumerator = position.timeSigNumerator;
+                mHostTimeSigDenominator = position.timeSigDenominator;
+            }
+        }
+    }
+    
+    //the governor only makes sense against a realtime deadline
+    const bool governorActive = *mGovernorParameter && ! isNonRealtime();
+    
+    if(! governorActive && mQualityGovernor.getTier() != QualityGovernor::fullQuality){
+        mQualityGovernor.reset();
+    }
+    
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    int mode = mModeParameter->getIndex();
+    
+    if(mode == 1){
+        processSpectral(buffer, numChannels, samples);
+    }
+    else if(mode == 2 || mode == 3){
+        processGrains(buffer, numChannels, samples, mode == 2);
+    }
+    else{
+        processDelay(buffer, numChannels, samples);
+    }
+    
+    if(governorActive){
+        //the delay kernel only has a cheaper variant at the minimal tier (no interpolation)
+        mQualityGovernor.setSkipsReducedTier(mode == 0);
         
-        mCircularBufferLeft.at(mCircularBufferWriteHead) = leftChannel[i] + mFeedbackLeft;
-        mCircularBufferRight.at(mCircularBufferWriteHead) = rightChannel[i] + mFeedbackRight;
+        auto elapsedTicks = juce::Time::getHighResolutionTicks() - startTicks;
+        mQualityGovernor.update(juce::Time::highResolutionTicksToSeconds(elapsedTicks), samples);
+    }
+}
+
+double DelayPlugInAudioProcessor::getTargetDelayTime() const
+{
+    if(! *mSyncParameter){
+        return *mDelayTimeParameter;
+    }
+    
+    const int index = mNoteValueParameter->getIndex();
+    const NoteValue& noteValue = noteValues[juce::jlimit(0, (int)juce::numElementsInArray(noteValues) - 1, index / 3)];
+    
+    const double quarterNotesPerBar = mHostTimeSigNumerator * 4.0 / mHostTimeSigDenominator;
+    const double quarterNotes = (noteValue.quarterNotes + noteValue.bars * quarterNotesPerBar) * noteModifiers[index % 3];
+    
+    //long note values are capped at what the delay lines hold, see MIN_SYNC_TEMPO
+    return juce::jlimit(0.001, (double)MAX_SYNC_DELAY_TIME, quarterNotes * 60.0 / mHostBpm);
+}
 
-        mDelayReadHead = mCircularBufferWriteHead - mDelayTimeInSamples;
+int DelayPlugInAudioProcessor::getQualityTier() const
+{
+    return mQualityGovernor.getTier();
+}
+
+const QualityGovernor& DelayPlugInAudioProcessor::getQualityGovernor() const
+{
+    return mQualityGovernor;
+}
 
-        if(mDelayReadHead < 0){
-           mDelayReadHead += mCircularBufferLength;
+void DelayPlugInAudioProcessor::processDelay(juce::AudioBuffer<float>& buffer, int numChannels, int samples)
+{
+    //take one snapshot of the parameters, then pick the kernel that does only the work this block needs
+    DelayBlockSettings settings;
+    settings.feedback = *mFeedbackParameter;
+    settings.dryWet = *mDryWetParameter;
+    settings.targetDelayTime = getTargetDelayTime();
+    settings.spectralTilt = *mSpectralTiltParameter;
+    settings.spectralHopMultiplier = 1;
+    
+    //once the smoother is within a hundredth of a sample of the target, snap to it so the static-delay kernel can be used
+    if(std::abs(mDelayTimeSmoothed - settings.targetDelayTime) * getSampleRate() < 0.01){
+        mDelayTimeSmoothed = settings.targetDelayTime;
+    }
+    
+    settings.startDelayTime = mDelayTimeSmoothed;
+    settings.startWriteHead = mCircularBufferWriteHead;
+    
+    //offline bounces use the render profile (4-point Hermite interpolation), the governor's lowest tier drops interpolation
+    Interpolation interpolation = Interpolation::linear;
+    
+    if(isNonRealtime()){
+        interpolation = Interpolation::cubic;
+    }
+    else if(getQualityTier() == QualityGovernor::minimalQuality){
+        interpolation = Interpolation::none;
+    }
+    
+    const bool hasFeedback = settings.feedback > 0.0f;
+    const bool movingDelay = mDelayTimeSmoothed != settings.targetDelayTime;
+    
+    DelayMixMode mix = DelayMixMode::blend;
+    
+    if(settings.dryWet <= 0.0f){
+        mix = DelayMixMode::dryOnly;
+    }
+    else if(settings.dryWet >= 1.0f){
+        mix = DelayMixMode::wetOnly;
+    }
+    
+    if(! hasFeedback){
+        std::fill(mFeedback.begin(), mFeedback.end(), 0.0f);
+    }
+    
+    //the smoother only moves towards the target, so between them they bound how far back this block reads,
+    //plus the interpolation points either side
+    const double longestDelayTime = juce::jmax(mDelayTimeSmoothed, (double)settings.targetDelayTime);
+    clearUnwrittenDelayLines((int)std::ceil(longestDelayTime * getSampleRate()) + 3, samples);
+    
+    mBlockSettings = settings;
+    mBlockKernel = selectDelayKernel(interpolation, hasFeedback, movingDelay, mix);
+    processChannels(&DelayPlugInAudioProcessor::processDelayChannels, buffer, numChannels, samples);
+    
+    //every channel ran its own copy of the smoother and write head, so move the shared ones on by the whole block
+    if(movingDelay){
+        mDelayTimeSmoothed = mDelayTimeSmoothed - (1.0 - std::pow(0.999, samples)) * (mDelayTimeSmoothed - settings.targetDelayTime);
+    }
+    
+    mCircularBufferWriteHead = (mCircularBufferWriteHead + samples) % mCircularBufferLength;
+}
+
+void DelayPlugInAudioProcessor::processDelayChannels(int firstChannel, int numChannels)
+{
+    for(int channel = firstChannel; channel < firstChannel + numChannels; channel++){
+        (this->*mBlockKernel)(mBlockChannels[channel], channel, mBlockSamples, mBlockSettings);
+    }
+}
+
+//==============================================================================
+// Kernel selection - each runtime flag is turned into a template argument in turn
+
+DelayPlugInAudioProcessor::DelayKernel DelayPlugInAudioProcessor::selectDelayKernel(Interpolation interpolation, bool hasFeedback, bool movingDelay,
+                                                                                    DelayMixMode mix)
+{
+    switch(interpolation){
+        case Interpolation::none:   return selectDelayKernel<Interpolation::none>(hasFeedback, movingDelay, mix);
+        case Interpolation::cubic:  return selectDelayKernel<Interpolation::cubic>(hasFeedback, movingDelay, mix);
+        case Interpolation::linear:
+        default:                    return selectDelayKernel<Interpolation::linear>(hasFeedback, movingDelay, mix);
+    }
+}
+
+template <DelayPlugInAudioProcessor::Interpolation Interp>
+DelayPlugInAudioProcessor::DelayKernel DelayPlugInAudioProcessor::selectDelayKernel(bool hasFeedback, bool movingDelay, DelayMixMode mix)
+{
+    return hasFeedback ? selectDelayKernel<Interp, true>(movingDelay, mix)
+                       : selectDelayKernel<Interp, false>(movingDelay, mix);
+}
+
+template <DelayPlugInAudioProcessor::Interpolation Interp, bool HasFeedback>
+DelayPlugInAudioProcessor::DelayKernel DelayPlugInAudioProcessor::selectDelayKernel(bool movingDelay, DelayMixMode mix)
+{
+    return movingDelay ? selectDelayKernel<Interp, HasFeedback, true>(mix)
+                       : selectDelayKernel<Interp, HasFeedback, false>(mix);
+}
+
+template <DelayPlugInAudioProcessor::Interpolation Interp, bool HasFeedback, bool MovingDelay>
+DelayPlugInAudioProcessor::DelayKernel DelayPlugInAudioProcessor::selectDelayKernel(DelayMixMode mix)
+{
+    switch(mix){
+        case DelayMixMode::dryOnly: return &DelayPlugInAudioProcessor::processDelayKernel<Interp, HasFeedback, MovingDelay, DelayMixMode::dryOnly>;
+        case DelayMixMode::wetOnly: return &DelayPlugInAudioProcessor::processDelayKernel<Interp, HasFeedback, MovingDelay, DelayMixMode::wetOnly>;
+        case DelayMixMode::blend:
+        default:                    return &DelayPlugInAudioProcessor::processDelayKernel<Interp, HasFeedback, MovingDelay, DelayMixMode::blend>;
+    }
+}
+
+//==============================================================================
+// The delay kernel, run once per channel. The template flags are compile-time constants,
+// so the branches on them below are removed by the compiler and each variant only does its own work.
+// Each channel only touches its own delay line and feedback sample, so channels can run on any thread.
+
+template <DelayPlugInAudioProcessor::Interpolation Interp, bool HasFeedback, bool MovingDelay, DelayPlugInAudioProcessor::DelayMixMode Mix>
+void DelayPlugInAudioProcessor::processDelayKernel(float* channelData, int channel, int samples, const DelayBlockSettings& settings)
+{
+    //the delay line only has to be read if something listens to it
+    const bool readsDelayLine = HasFeedback || Mix != DelayMixMode::dryOnly;
+    
+    const double sampleRate = getSampleRate();
+    float* circularBuffer = mBlockDelayLines[channel];
+    float feedbackSample = mFeedback[channel];
+    
+    double delayTimeSmoothed = settings.startDelayTime;
+    double delayTimeInSamples = sampleRate * delayTimeSmoothed;
+    int writeHead = settings.startWriteHead;
+    
+    //loops through the samples in the buffer
+    for(int i = 0; i < samples; i++){
+        
+        if(MovingDelay){
+            delayTimeSmoothed = delayTimeSmoothed - 0.001 * (delayTimeSmoothed - settings.targetDelayTime);
+            delayTimeInSamples = sampleRate * delayTimeSmoothed;
         }
         
-        //linear interpolation code
+        //unchecked indexing - the read and write heads are always wrapped into [0, mCircularBufferLength)
+        circularBuffer[writeHead] = channelData[i] + (HasFeedback ? feedbackSample : 0.0f);
         
-        int readHead_x = (int)mDelayReadHead;
-        int readHead_x1 = readHead_x + 1;
-        float readHeadFloat = mDelayReadHead - readHead_x;
-
-        if(readHead_x1 >= mCircularBufferLength){
-            readHead_x1 -= mCircularBufferLength;
+        if(readsDelayLine){
+            
+            double readHead = writeHead - delayTimeInSamples;
+            
+            if(readHead < 0){
+               readHead += mCircularBufferLength;
+            }
+            
+            //interpolation code
+            
+            int readHead_x = juce::jlimit(0, mCircularBufferLength - 1, (int)readHead);
+            int readHead_x1 = readHead_x + 1;
+            float readHeadFloat = (float)(readHead - readHead_x);
+            
+            if(readHead_x1 >= mCircularBufferLength){
+                readHead_x1 -= mCircularBufferLength;
+            }
+            
+            float delaySample;
+            
+            if(Interp == Interpolation::none){
+                delaySample = circularBuffer[readHead_x];
+            }
+            else if(Interp == Interpolation::cubic){
+                int readHead_xm1 = readHead_x == 0 ? mCircularBufferLength - 1 : readHead_x - 1;
+                int readHead_x2 = readHead_x1 + 1 == mCircularBufferLength ? 0 : readHead_x1 + 1;
+                
+                delaySample = hermiteInterp(circularBuffer[readHead_xm1], circularBuffer[readHead_x], circularBuffer[readHead_x1], circularBuffer[readHead_x2], readHeadFloat);
+            }
+            else{
+                delaySample = linearInterp(circularBuffer[readHead_x], circularBuffer[readHead_x1], readHeadFloat); //output signal
+            }
+            
+            if(HasFeedback){
+                feedbackSample = delaySample * settings.feedback;
+            }
+            
+            if(Mix == DelayMixMode::wetOnly){
+                channelData[i] = delaySample;
+            }
+            else if(Mix == DelayMixMode::blend){
+                channelData[i] = channelData[i] * (1 - settings.dryWet) + delaySample * settings.dryWet;
+            }
+        }
+        
+        writeHead++;
+        
+        if(writeHead == mCircularBufferLength){
+           writeHead = 0;
         }
+    }
+    
+    mFeedback[channel] = feedbackSample;
+}
 
-        float delaySampleLeft = linearInterp(mCircularBufferLeft.at(readHead_x), mCircularBufferLeft.at(readHead_x1), readHeadFloat); //output signal
-        float delaySampleRight = linearInterp(mCircularBufferRight.at(readHead_x), mCircularBufferRight.at(readHead_x1), readHeadFloat);
+//==============================================================================
+void DelayPlugInAudioProcessor::processChannels(ChannelJob job, juce::AudioBuffer<float>& buffer, int numChannels, int samples)
+{
+    mBlockChannels = buffer.getArrayOfWritePointers();
+    mBlockDelayLines = mCircularBuffer.getArrayOfWritePointers();
+    mBlockSamples = samples;
+    mBlockNumChannels = numChannels;
+    mBlockJob = job;
+    
+    int numGroups = 1;
+    
+    if(*mMultithreadParameter){
+        numGroups = juce::jmin(mChannelGroupPool.getNumWorkers() + 1, numChannels / MIN_CHANNELS_PER_GROUP);
+    }
+    
+    if(numGroups <= 1){
+        (this->*job)(0, numChannels);
+        return;
+    }
+    
+    mBlockNumGroups = numGroups;
+    mChannelGroupPool.run(numGroups, &DelayPlugInAudioProcessor::runChannelGroup, this);
+}
 
-//        float delaySampleLeft = mCircularBufferLeft[(int)mDelayReadHead]; //output signal
-//        float delaySampleRight = mCircularBufferRight[(int)mDelayReadHead]; //output signal
+void DelayPlugInAudioProcessor::runChannelGroup(void* context, int groupIndex)
+{
+    juce::ScopedNoDenormals noDenormals; //the workers don't inherit the audio thread's floating point mode
+    
+    auto* processor = static_cast<DelayPlugInAudioProcessor*>(context);
+    
+   #if DELAYPLUGIN_REALTIME_AUDIT
+    RealtimeAudit::ScopedProcessBlock realtimeAudit(! processor->isNonRealtime()); //a worker is processing audio too
+   #endif
+    
+    //spread the channels as evenly as they divide
+    const int firstChannel = groupIndex * processor->mBlockNumChannels / processor->mBlockNumGroups;
+    const int endChannel = (groupIndex + 1) * processor->mBlockNumChannels / processor->mBlockNumGroups;
+    
+    (processor->*processor->mBlockJob)(firstChannel, endChannel - firstChannel);
+}
+
+void DelayPlugInAudioProcessor::advanceDelayTimeSmoother(int samples)
+{
+    const double targetDelayTime = getTargetDelayTime();
+    
+    //the delay mode's one-pole smoother, advanced a whole block at once
+    mDelayTimeSmoothed = mDelayTimeSmoothed - (1.0 - std::pow(0.999, samples)) * (mDelayTimeSmoothed - targetDelayTime);
+    
+    //snap the last hundredth of a sample, so the per-bin delays stop being recalculated once it arrives
+    if(std::abs(mDelayTimeSmoothed - targetDelayTime) * getSampleRate() < 0.01){
+        mDelayTimeSmoothed = targetDelayTime;
+    }
+}
 
-        mFeedbackLeft = delaySampleLeft * *mFeedbackParameter;
-        mFeedbackRight = delaySampleRight * *mFeedbackParameter;
+void DelayPlugInAudioProcessor::processSpectral(juce::AudioBuffer<float>& buffer, int numChannels, int samples)
+{
+    //tempo changes and delay time moves glide here too, at block rate
+    advanceDelayTimeSmoother(samples);
+    
+    DelayBlockSettings settings;
+    settings.feedback = *mFeedbackParameter;
+    settings.dryWet = *mDryWetParameter;
+    settings.targetDelayTime = getTargetDelayTime();
+    settings.spectralTilt = *mSpectralTiltParameter;
+    //the hop the user picked, doubled at each governor tier - SpectralDelay stops at half the FFT size,
+    //the longest hop the windows still overlap-add at
+    settings.spectralHopMultiplier = (1 << mSpectralHopParameter->getIndex()) << getQualityTier();
+    settings.startDelayTime = mDelayTimeSmoothed;
+    settings.startWriteHead = mCircularBufferWriteHead;
+    
+    mBlockSettings = settings;
+    processChannels(&DelayPlugInAudioProcessor::processSpectralChannels, buffer, numChannels, samples);
+}
+
+void DelayPlugInAudioProcessor::processSpectralChannels(int firstChannel, int numChannels)
+{
+    //per-bin parameters are only recalculated when a control moves, and changes land on the next hop
+    for(int channel = firstChannel; channel < firstChannel + numChannels; channel++){
+        SpectralDelay* spectralDelay = mSpectralDelays.getUnchecked(channel);
+        spectralDelay->setHopMultiplier(mBlockSettings.spectralHopMultiplier);
+        spectralDelay->setParameters((float)mBlockSettings.startDelayTime, mBlockSettings.feedback, mBlockSettings.spectralTilt);
+        spectralDelay->process(mBlockChannels[channel], mBlockSamples, mBlockSettings.dryWet);
+    }
+}
+
+void DelayPlugInAudioProcessor::processGrains(juce::AudioBuffer<float>& buffer, int numChannels, int samples, bool reverse)
+{
+    //grains are scheduled from block-rate parameters
+    advanceDelayTimeSmoother(samples);
+    
+    //each governor tier halves the number of grains allowed to overlap, and offline bounces read them with the
+    //same 4-point Hermite interpolation as the delay mode's render profile
+    mGrainEngine.setMaxActiveGrains(GrainEngine::maxGrains >> getQualityTier());
+    mGrainEngine.setCubicInterpolation(isNonRealtime());
+    
+    mGrainEngine.setParameters((float)(getSampleRate() * mDelayTimeSmoothed), *mGrainSizeParameter, *mGrainDensityParameter,
+                               *mGrainJitterParameter, *mGrainPitchParameter, reverse, mCircularBufferLength);
+    
+    //only as far back as this block's grains can reach, rather than the whole of the long delay lines
+    clearUnwrittenDelayLines(mGrainEngine.getMaxReadDistance(mCircularBufferLength), samples);
+    
+    //the grains are shared by every channel, so this mode always runs on the audio thread
+    float* const* channels = buffer.getArrayOfWritePointers();
+    float* const* circularBuffers = mCircularBuffer.getArrayOfWritePointers();
+    
+    const float feedback = *mFeedbackParameter;
+    const float dryWet = *mDryWetParameter;
+    
+    float grainSamples[MAX_CHANNELS];
+    
+    for(int i = 0; i < samples; i++){
+        
+        for(int channel = 0; channel < numChannels; channel++){
+            circularBuffers[channel][mCircularBufferWriteHead] = channels[channel][i] + mFeedback[channel];
+        }
+        
+        mGrainEngine.renderSample(circularBuffers, numChannels, mCircularBufferLength, mCircularBufferWriteHead, grainSamples);
+        
+        for(int channel = 0; channel < numChannels; channel++){
+            mFeedback[channel] = grainSamples[channel] * feedback;
+            channels[channel][i] = channels[channel][i] * (1 - dryWet) + grainSamples[channel] * dryWet;
+        }
         
         mCircularBufferWriteHead++;
         
-        buffer.setSample(0, i, buffer.getSample(0, i) * (1 - *mDryWetParameter) + delaySampleLeft * *mDryWetParameter);
-        buffer.setSample(1, i, buffer.getSample(1, i) * (1 - *mDryWetParameter) + delaySampleRight * *mDryWetParameter);
-
         if(mCircularBufferWriteHead == mCircularBufferLength){
            mCircularBufferWriteHead = 0;
         }
@@ -233,15 +760,45 @@ juce::AudioProcessorEditor* DelayPlugInAudioProcessor::createEditor()
 //==============================================================================
 void DelayPlugInAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // The state is stored as XML with one attribute per parameter ID, which is also
+    // the format the BatchRender tool reads its preset files in.
+    copyXmlToBinary(*createStateXml(), destData);
 }
 
 void DelayPlugInAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    if(auto xml = getXmlFromBinary(data, sizeInBytes)){
+        applyStateXml(*xml);
+    }
+}
+
+std::unique_ptr<juce::XmlElement> DelayPlugInAudioProcessor::createStateXml() const
+{
+    auto xml = std::make_unique<juce::XmlElement>("DelayPlugInState");
+    
+    for(auto* param : getParameters()){
+        if(auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*>(param)){
+            xml->setAttribute(rangedParam->paramID, rangedParam->convertFrom0to1(rangedParam->getValue()));
+        }
+    }
+    
+    return xml;
+}
+
+void DelayPlugInAudioProcessor::applyStateXml(const juce::XmlElement& xml)
+{
+    if(! xml.hasTagName("DelayPlugInState")){
+        return;
+    }
+    
+    for(auto* param : getParameters()){
+        if(auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*>(param)){
+            if(xml.hasAttribute(rangedParam->paramID)){
+                auto value = (float)xml.getDoubleAttribute(rangedParam->paramID);
+                rangedParam->setValueNotifyingHost(rangedParam->convertTo0to1(value));
+            }
+        }
+    }
 }
 
 //==============================================================================
@@ -254,3 +811,12 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 float DelayPlugInAudioProcessor::linearInterp(float sample_x, float sample_x1, float in_phase){
     return (1 - in_phase) * sample_x + in_phase * sample_x1;
 }
+
+float DelayPlugInAudioProcessor::hermiteInterp(float sample_xm1, float sample_x, float sample_x1, float sample_x2, float in_phase){
+    //4-point, 3rd-order Hermite (Catmull-Rom) - interpolates between sample_x and sample_x1
+    float c1 = 0.5f * (sample_x1 - sample_xm1);
+    float c2 = sample_xm1 - 2.5f * sample_x + 2.0f * sample_x1 - 0.5f * sample_x2;
+    float c3 = 0.5f * (sample_x2 - sample_xm1) + 1.5f * (sample_x - sample_x1);
+    
+    return ((c3 * in_phase + c2) * in_phase + c1) * in_phase + sample_x;
+}
@@ -10,8 +10,26 @@
 
 #include <JuceHeader.h>
 #include <vector>
+#include "SpectralDelay.h"
+#include "GrainEngine.h"
+#include "QualityGovernor.h"
+#include "ChannelGroupPool.h"
+#include "RealtimeAudit.h"
 
-#define MAX_DELAY_TIME 2
+#define MAX_DELAY_TIME 2 //longest setting of the delay time control
+#define MIN_SYNC_TEMPO 60 //synced note values up to 4 bars of 4/4 play at their full length down to this tempo...
+#define MAX_SYNC_DELAY_TIME 16 //...which makes the longest of them 16 seconds. Dotted 4 bars only fit down to 90bpm, and bars
+                               //of longer time signatures down to proportionally faster tempos - below that they're capped
+#define MAX_DELAY_LINE_TIME 16 //what the delay lines hold, the longer of the two
+#define DELAY_LINE_GUARD_SAMPLES 4 //room past the longest delay for the interpolators' outer points
+#define MAX_SPECTRAL_DELAY_TIME 3 //the spectral frame rings stay shorter, longer delay times are capped there
+#define MAX_TAIL_TIME 30 //longest tail reported, feedback near the top of its range takes minutes to fall 60dB
+
+#define MAX_CHANNELS 64 //widest bus accepted, enough for 7th-order ambisonics
+#define MIN_CHANNELS_PER_GROUP 4 //fewer channels than this per thread don't pay for the handoff
+
+#define SPECTRAL_FFT_ORDER 10 //1024-point frames
+#define SPECTRAL_MIN_HOP_SIZE 128 //shortest hop the Spectral Hop control offers (8x overlap), the frame rings are laid out for it
 
 //==============================================================================
 /**
@@ -26,6 +44,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -56,27 +75,120 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
+    std::unique_ptr<juce::XmlElement> createStateXml() const; //parameter values keyed by parameter ID
+    void applyStateXml(const juce::XmlElement& xml);
+    
+    double getTargetDelayTime() const; //in seconds, from the delay time control or the synced note value at the host tempo
+    
+    int getQualityTier() const; //current CPU governor tier, QualityGovernor::fullQuality when the governor is off
+    const QualityGovernor& getQualityGovernor() const;
+    
     float linearInterp(float sample_x, float sample_x1, float in_phase); //linear interpolation method
+    float hermiteInterp(float sample_xm1, float sample_x, float sample_x1, float sample_x2, float in_phase); //cubic interpolation, used when rendering offline
+    
+   #if DELAYPLUGIN_REALTIME_AUDIT
+    static int getRealtimeViolationCount(); //calls that aren't realtime-safe seen while processing audio since the last reset, see RealtimeAudit.h
+    static void resetRealtimeViolationCount();
+   #endif
 
 private:
     
+    //==============================================================================
+    enum class Interpolation { none, linear, cubic };
+    enum class DelayMixMode { blend, dryOnly, wetOnly };
+    
+    struct DelayBlockSettings //parameter snapshot taken once per block
+    {
+        float feedback;
+        float dryWet;
+        float targetDelayTime;
+        float spectralTilt;
+        int spectralHopMultiplier;
+        
+        //smoother state and write head at the start of the block - every channel
+        //follows the same trajectory from here on its own copy
+        double startDelayTime;
+        int startWriteHead;
+    };
+    
+    using DelayKernel = void (DelayPlugInAudioProcessor::*)(float*, int, int, const DelayBlockSettings&);
+    using ChannelJob = void (DelayPlugInAudioProcessor::*)(int, int);
+    
+    void processDelay(juce::AudioBuffer<float>& buffer, int numChannels, int samples);
+    void processDelayChannels(int firstChannel, int numChannels);
+    
+    template <Interpolation Interp, bool HasFeedback, bool MovingDelay, DelayMixMode Mix>
+    void processDelayKernel(float* channelData, int channel, int samples, const DelayBlockSettings& settings);
+    
+    static DelayKernel selectDelayKernel(Interpolation interpolation, bool hasFeedback, bool movingDelay, DelayMixMode mix);
+    template <Interpolation Interp>
+    static DelayKernel selectDelayKernel(bool hasFeedback, bool movingDelay, DelayMixMode mix);
+    template <Interpolation Interp, bool HasFeedback>
+    static DelayKernel selectDelayKernel(bool movingDelay, DelayMixMode mix);
+    template <Interpolation Interp, bool HasFeedback, bool MovingDelay>
+    static DelayKernel selectDelayKernel(DelayMixMode mix);
+    
+    //==============================================================================
+    void processSpectral(juce::AudioBuffer<float>& buffer, int numChannels, int samples);
+    void processSpectralChannels(int firstChannel, int numChannels);
+    void processGrains(juce::AudioBuffer<float>& buffer, int numChannels, int samples, bool reverse);
+    
+    //moves the delay time smoother on by a whole block, for the modes that only update their delay once per block
+    void advanceDelayTimeSmoother(int samples);
+    
+    //zeroes whatever part of the delay lines this block could read that hasn't been written since the last reset
+    void clearUnwrittenDelayLines(int lookbackSamples, int samples);
+    
+    //runs job over every channel of the block, split into groups across the worker pool when multithreading is on
+    void processChannels(ChannelJob job, juce::AudioBuffer<float>& buffer, int numChannels, int samples);
+    static void runChannelGroup(void* context, int groupIndex);
+    
     juce::AudioParameterFloat* mDryWetParameter;
     juce::AudioParameterFloat* mFeedbackParameter;
     juce::AudioParameterFloat* mDelayTimeParameter;
+    juce::AudioParameterChoice* mModeParameter;
+    juce::AudioParameterFloat* mSpectralTiltParameter;
+    juce::AudioParameterFloat* mGrainSizeParameter;
+    juce::AudioParameterFloat* mGrainDensityParameter;
+    juce::AudioParameterFloat* mGrainJitterParameter;
+    juce::AudioParameterFloat* mGrainPitchParameter;
+    juce::AudioParameterBool* mGovernorParameter;
+    juce::AudioParameterBool* mMultithreadParameter;
+    juce::AudioParameterBool* mSyncParameter;
+    juce::AudioParameterChoice* mNoteValueParameter;
+    juce::AudioParameterChoice* mSpectralHopParameter;
     
-    float mDelayTimeSmoothed;
+    double mHostBpm; //last tempo and time signature reported by the play head
+    int mHostTimeSigNumerator;
+    int mHostTimeSigDenominator;
     
-    float mFeedbackLeft;
-    float mFeedbackRight;
+    double mDelayTimeSmoothed; //double precision so the one-pole smoother and read head don't drift on long renders
     
-    float mDelayTimeInSamples;
-    float mDelayReadHead; 
+    std::vector<float> mFeedback; //one feedback sample per channel
     
     int mCircularBufferWriteHead;
     int mCircularBufferLength;
+    int mCircularBufferZeroedFrom; //[mCircularBufferZeroedFrom, mCircularBufferLength) is known to be zero, 0 once the lines are full
+    
+    juce::AudioBuffer<float> mCircularBuffer; //one delay line per channel
+    
+    juce::OwnedArray<SpectralDelay> mSpectralDelays;
+    
+    GrainEngine mGrainEngine;
+    
+    QualityGovernor mQualityGovernor;
+    
+    ChannelGroupPool mChannelGroupPool; //as many workers as the bus has full groups of channels for, bounded by the cores
     
-    std::vector<float> mCircularBufferLeft;
-    std::vector<float> mCircularBufferRight;
+    //the block being processed, set up by the audio thread before processChannels() and only read by the channel groups
+    float* const* mBlockChannels;
+    float* const* mBlockDelayLines;
+    int mBlockSamples;
+    int mBlockNumChannels;
+    int mBlockNumGroups;
+    DelayBlockSettings mBlockSettings;
+    DelayKernel mBlockKernel;
+    ChannelJob mBlockJob;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayPlugInAudioProcessor)
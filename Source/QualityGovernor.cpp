@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.cpp
+
+  ==============================================================================
+*/
+
+#include "QualityGovernor.h"
+
+//==============================================================================
+QualityGovernor::QualityGovernor()
+{
+    mSampleRate = 0;
+    mSkipsReducedTier = false;
+
+    for(int i = 0; i < historySize; i++){
+        mHistoryTier[i] = 0;
+        mHistoryTime[i] = 0;
+    }
+
+    mNumSwitches = 0;
+    reset();
+}
+
+void QualityGovernor::prepare(double sampleRate)
+{
+    mSampleRate = sampleRate;
+    reset();
+}
+
+void QualityGovernor::reset()
+{
+    mTier = fullQuality;
+    mAverageLoad = 0;
+    mSecondsSinceSwitch = 0;
+    mSecondsBelowStepUp = 0;
+}
+
+void QualityGovernor::update(double elapsedSeconds, int numSamples)
+{
+    if(numSamples == 0 || mSampleRate <= 0){
+        return;
+    }
+
+    const double blockSeconds = numSamples / mSampleRate;
+    const float load = (float)(elapsedSeconds / blockSeconds);
+
+    //exponential moving average with a time constant of roughly 100ms, whatever the block size
+    const float smoothing = (float)juce::jmin(1.0, blockSeconds / 0.1);
+    const float averageLoad = mAverageLoad.load() + smoothing * (load - mAverageLoad.load());
+    mAverageLoad = averageLoad;
+
+    mSecondsSinceSwitch += blockSeconds;
+    mSecondsBelowStepUp = averageLoad < stepUpLoad ? mSecondsBelowStepUp + blockSeconds : 0.0;
+
+    //give each switch a moment to show up in the average before acting again
+    if(mSecondsSinceSwitch < 0.25){
+        return;
+    }
+
+    const int tier = mTier.load();
+
+    //the mode changed under a tier that does nothing for it, so keep the saving by going one further
+    if(mSkipsReducedTier && tier == reducedQuality){
+        setTier(minimalQuality);
+    }
+    else if(averageLoad > stepDownLoad && tier < numTiers - 1){
+        setTier(getNextTier(tier, 1));
+    }
+    else if(mSecondsBelowStepUp >= recoverySeconds && tier > fullQuality){
+        setTier(getNextTier(tier, -1));
+    }
+}
+
+void QualityGovernor::setSkipsReducedTier(bool shouldSkip)
+{
+    mSkipsReducedTier = shouldSkip;
+}
+
+int QualityGovernor::getNextTier(int tier, int direction) const
+{
+    const int nextTier = tier + direction;
+
+    if(mSkipsReducedTier && nextTier == reducedQuality){
+        return nextTier + direction;
+    }
+
+    return nextTier;
+}
+
+void QualityGovernor::setTier(int newTier)
+{
+    mTier = newTier;
+    mSecondsSinceSwitch = 0;
+    mSecondsBelowStepUp = 0;
+
+    const int slot = mNumSwitches.load() % historySize;
+    mHistoryTier[slot] = newTier;
+    mHistoryTime[slot] = juce::Time::getMillisecondCounter();
+    ++mNumSwitches;
+}
+
+int QualityGovernor::getTier() const
+{
+    return mTier.load();
+}
+
+float QualityGovernor::getAverageLoad() const
+{
+    return mAverageLoad.load();
+}
+
+int QualityGovernor::getNumSwitches() const
+{
+    return juce::jmin(mNumSwitches.load(), historySize);
+}
+
+QualityGovernor::Switch QualityGovernor::getSwitch(int index) const
+{
+    const int slot = (mNumSwitches.load() - 1 - index + historySize * 2) % historySize;
+    return { mHistoryTier[slot].load(), mHistoryTime[slot].load() };
+}
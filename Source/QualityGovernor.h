@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+
+    Watches how much of each block's time budget processBlock uses and steps
+    the plugin down to cheaper processing when the machine runs out of headroom.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    update() is called from the audio thread at the end of every block. The tier
+    and switch history are stored in atomics so the editor can read them from the
+    message thread without locking.
+*/
+class QualityGovernor
+{
+public:
+    enum Tier
+    {
+        fullQuality = 0,
+        reducedQuality,
+        minimalQuality,
+        numTiers
+    };
+
+    static constexpr float stepDownLoad = 0.25f; //average share of the block budget that triggers a step down
+    static constexpr float stepUpLoad = 0.10f; //...and the share it has to stay under before stepping back up
+    static constexpr double recoverySeconds = 2.0; //how long the load has to stay low before stepping up
+    static constexpr int historySize = 8;
+
+    struct Switch
+    {
+        int tier;
+        juce::uint32 timeMs;
+    };
+
+    QualityGovernor();
+
+    void prepare(double sampleRate);
+    void reset();
+
+    void update(double elapsedSeconds, int numSamples);
+
+    //for modes where the reduced tier is no cheaper than full quality - the governor then steps
+    //straight between full and minimal, and leaves the reduced tier at the next update
+    void setSkipsReducedTier(bool shouldSkip);
+
+    int getTier() const;
+    float getAverageLoad() const;
+
+    //the most recent tier changes, index 0 being the latest
+    int getNumSwitches() const;
+    Switch getSwitch(int index) const;
+
+private:
+    void setTier(int newTier);
+    int getNextTier(int tier, int direction) const;
+
+    double mSampleRate;
+    double mSecondsSinceSwitch;
+    double mSecondsBelowStepUp;
+    bool mSkipsReducedTier;
+
+    std::atomic<int> mTier;
+    std::atomic<float> mAverageLoad;
+
+    std::atomic<int> mNumSwitches;
+    std::atomic<int> mHistoryTier[historySize];
+    std::atomic<juce::uint32> mHistoryTime[historySize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QualityGovernor)
+};
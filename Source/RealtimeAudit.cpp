@@ -0,0 +1,291 @@
+/*
+  ==============================================================================
+
+    RealtimeAudit.cpp
+
+  ==============================================================================
+*/
+
+//the audit replaces read() and write(), which fortified C headers define inline
+#undef _FORTIFY_SOURCE
+
+#include "RealtimeAudit.h"
+
+#if DELAYPLUGIN_REALTIME_AUDIT
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <cstdarg>
+ #include <dlfcn.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+namespace RealtimeAudit
+{
+    thread_local bool insideProcessBlock = false;
+
+    static std::atomic<int> violationCounts[numKinds];
+    static std::atomic<const char*> lastViolations[numKinds];
+
+    static void report(Kind kind, const char* function)
+    {
+        //cleared while reporting - the assertion handler may well allocate or lock itself
+        insideProcessBlock = false;
+
+        violationCounts[kind]++;
+        lastViolations[kind] = function;
+        jassertfalse; //a call that isn't realtime-safe was made while processing audio
+
+        insideProcessBlock = true;
+    }
+
+    static inline void check(Kind kind, const char* function)
+    {
+        if(insideProcessBlock){
+            report(kind, function);
+        }
+    }
+
+    int getViolationCount()
+    {
+        int count = 0;
+
+        for(auto& kindCount : violationCounts){
+            count += kindCount.load();
+        }
+
+        return count;
+    }
+
+    int getViolationCount(Kind kind)
+    {
+        return violationCounts[kind].load();
+    }
+
+    const char* getLastViolation(Kind kind)
+    {
+        return lastViolations[kind].load();
+    }
+
+    const char* getKindName(Kind kind)
+    {
+        switch(kind){
+            case allocation:     return "allocation";
+            case lock:           return "lock";
+            case blockingCall:   return "blocking call";
+            case fileAccess:     return "file access";
+            case threadCreation: return "thread creation";
+            case threadWake:     return "thread wake";
+            case numKinds:       break;
+        }
+
+        return "";
+    }
+
+    void resetViolationCounts()
+    {
+        for(int kind = 0; kind < numKinds; kind++){
+            violationCounts[kind] = 0;
+            lastViolations[kind] = nullptr;
+        }
+    }
+}
+
+//==============================================================================
+// The C allocator underneath new and delete - glibc's own entry points on Linux, so that
+// an allocation through new is only counted once, as new, and not again as malloc
+
+#if JUCE_LINUX
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+static void* allocateUnaudited(size_t size) { return __libc_malloc(size); }
+static void freeUnaudited(void* ptr)        { __libc_free(ptr); }
+#else
+static void* allocateUnaudited(size_t size) { return std::malloc(size); }
+static void freeUnaudited(void* ptr)        { std::free(ptr); }
+#endif
+
+void* operator new(std::size_t size)
+{
+    RealtimeAudit::check(RealtimeAudit::allocation, "operator new");
+
+    if(auto* ptr = allocateUnaudited(size == 0 ? 1 : size)){
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)                    { return operator new(size); }
+void operator delete(void* ptr) noexcept                  { if(ptr != nullptr) RealtimeAudit::check(RealtimeAudit::allocation, "operator delete"); freeUnaudited(ptr); }
+void operator delete[](void* ptr) noexcept                { operator delete(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept     { operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept   { operator delete(ptr); }
+
+#if JUCE_LINUX
+//==============================================================================
+// The C entry points. Allocation goes straight to glibc, everything else to whichever
+// definition comes next after this one - looked up during static initialisation, so the
+// audio thread never has to go through the dynamic linker for it
+
+extern "C"
+{
+    void* malloc(size_t size) __THROW
+    {
+        RealtimeAudit::check(RealtimeAudit::allocation, "malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) __THROW
+    {
+        RealtimeAudit::check(RealtimeAudit::allocation, "calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size) __THROW
+    {
+        RealtimeAudit::check(RealtimeAudit::allocation, "realloc");
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr) __THROW
+    {
+        if(ptr != nullptr){
+            RealtimeAudit::check(RealtimeAudit::allocation, "free");
+        }
+
+        __libc_free(ptr);
+    }
+
+    void* memalign(size_t alignment, size_t size) __THROW
+    {
+        RealtimeAudit::check(RealtimeAudit::allocation, "memalign");
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) __THROW
+    {
+        RealtimeAudit::check(RealtimeAudit::allocation, "aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, size_t alignment, size_t size) __THROW
+    {
+        RealtimeAudit::check(RealtimeAudit::allocation, "posix_memalign");
+
+        if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0){
+            return EINVAL;
+        }
+
+        void* allocated = __libc_memalign(alignment, size);
+
+        if(allocated == nullptr){
+            return ENOMEM;
+        }
+
+        *ptr = allocated;
+        return 0;
+    }
+}
+
+namespace RealtimeAudit
+{
+    template <typename Function>
+    static Function findNext(std::atomic<void*>& cached, const char* name)
+    {
+        void* function = cached.load(std::memory_order_relaxed);
+
+        //only still unresolved if it's called during static initialisation, before its turn
+        if(function == nullptr){
+            function = dlsym(RTLD_NEXT, name);
+            cached.store(function, std::memory_order_relaxed);
+        }
+
+        return reinterpret_cast<Function>(function);
+    }
+}
+
+//defines an interposer that reports the call and passes it on to the real function
+#define REALTIME_AUDIT_INTERPOSE(kind, returnType, name, parameters, arguments, exceptionSpec) \
+    static std::atomic<void*> next_##name { dlsym(RTLD_NEXT, #name) }; \
+    \
+    extern "C" returnType name parameters exceptionSpec \
+    { \
+        RealtimeAudit::check(RealtimeAudit::kind, #name); \
+        return RealtimeAudit::findNext<returnType (*) parameters>(next_##name, #name) arguments; \
+    }
+
+REALTIME_AUDIT_INTERPOSE(lock, int, pthread_mutex_lock, (pthread_mutex_t* mutex), (mutex), __THROWNL)
+REALTIME_AUDIT_INTERPOSE(lock, int, pthread_rwlock_rdlock, (pthread_rwlock_t* rwlock), (rwlock), __THROWNL)
+REALTIME_AUDIT_INTERPOSE(lock, int, pthread_rwlock_wrlock, (pthread_rwlock_t* rwlock), (rwlock), __THROWNL)
+
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, nanosleep, (const struct timespec* duration, struct timespec* remaining), (duration, remaining), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, clock_nanosleep, (clockid_t clock, int flags, const struct timespec* duration, struct timespec* remaining),
+                         (clock, flags, duration, remaining), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, usleep, (useconds_t microseconds), (microseconds), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, sched_yield, (void), (), __THROW)
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, pthread_join, (pthread_t thread, void** result), (thread, result), )
+
+//waits on condition variables and semaphores block by definition, and waking a waiter is a futex
+//call that can end up in the scheduler, both on the audio thread and on a channel worker
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, pthread_cond_wait, (pthread_cond_t* condition, pthread_mutex_t* mutex), (condition, mutex), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, pthread_cond_timedwait, (pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* until),
+                         (condition, mutex, until), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, sem_wait, (sem_t* semaphore), (semaphore), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, sem_timedwait, (sem_t* semaphore, const struct timespec* until), (semaphore, until), )
+
+#if __GLIBC_PREREQ(2, 30)
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, pthread_cond_clockwait, (pthread_cond_t* condition, pthread_mutex_t* mutex, clockid_t clock, const struct timespec* until),
+                         (condition, mutex, clock, until), )
+REALTIME_AUDIT_INTERPOSE(blockingCall, int, sem_clockwait, (sem_t* semaphore, clockid_t clock, const struct timespec* until), (semaphore, clock, until), )
+#endif
+
+REALTIME_AUDIT_INTERPOSE(threadWake, int, pthread_cond_signal, (pthread_cond_t* condition), (condition), __THROWNL)
+REALTIME_AUDIT_INTERPOSE(threadWake, int, pthread_cond_broadcast, (pthread_cond_t* condition), (condition), __THROWNL)
+REALTIME_AUDIT_INTERPOSE(threadWake, int, sem_post, (sem_t* semaphore), (semaphore), __THROWNL)
+
+REALTIME_AUDIT_INTERPOSE(fileAccess, ssize_t, read, (int fd, void* buffer, size_t size), (fd, buffer, size), )
+REALTIME_AUDIT_INTERPOSE(fileAccess, ssize_t, write, (int fd, const void* buffer, size_t size), (fd, buffer, size), )
+REALTIME_AUDIT_INTERPOSE(fileAccess, int, close, (int fd), (fd), )
+
+REALTIME_AUDIT_INTERPOSE(threadCreation, int, pthread_create,
+                         (pthread_t* thread, const pthread_attr_t* attributes, void* (*function)(void*), void* argument),
+                         (thread, attributes, function, argument), __THROWNL)
+
+#undef REALTIME_AUDIT_INTERPOSE
+
+//open() takes its mode as a variadic argument, so it's passed on by hand
+static std::atomic<void*> next_open { dlsym(RTLD_NEXT, "open") };
+
+extern "C" int open(const char* path, int flags, ...)
+{
+    RealtimeAudit::check(RealtimeAudit::fileAccess, "open");
+
+    mode_t mode = 0;
+
+    if((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE){
+        va_list arguments;
+        va_start(arguments, flags);
+        mode = (mode_t)va_arg(arguments, int);
+        va_end(arguments);
+    }
+
+    return RealtimeAudit::findNext<int (*)(const char*, int, ...)>(next_open, "open")(path, flags, mode);
+}
+#endif
+
+#endif
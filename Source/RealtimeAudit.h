@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    RealtimeAudit.h
+
+    Diagnostic build only: counts every call that isn't realtime-safe -
+    allocations, locks, sleeps and waits, file access, and starting or waking
+    threads - made on a thread while it is processing audio for processBlock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Set to 1 (e.g. in the Projucer preprocessor definitions) to build the diagnostic
+// version. The RealtimeAudit target does, and drives the processor with it.
+#ifndef DELAYPLUGIN_REALTIME_AUDIT
+ #define DELAYPLUGIN_REALTIME_AUDIT 0
+#endif
+
+#if DELAYPLUGIN_REALTIME_AUDIT
+
+//==============================================================================
+/**
+    new and delete are replaced everywhere. On Linux the C allocation functions,
+    pthread mutex and rwlock locking, sleeps and yields, condition variable and
+    semaphore waits and wakes (which is how a juce::WaitableEvent is waited on
+    and notified), thread creation and joins, and open/read/write/close are
+    interposed as well. That only catches calls from code linked into the
+    executable - as it is in the RealtimeAudit target, but not in a plugin the
+    host loads - and not raw futex system calls made without going through
+    the C library.
+
+    Offline renders have no deadline, so they aren't audited.
+*/
+namespace RealtimeAudit
+{
+    enum Kind
+    {
+        allocation,
+        lock,
+        blockingCall, //sleeps, yields, thread joins, and condition variable and semaphore waits
+        fileAccess,
+        threadCreation,
+        threadWake,   //signalling a condition variable or posting a semaphore
+        numKinds
+    };
+
+    //set while the thread is running audio for processBlock, on the audio thread and on channel workers
+    extern thread_local bool insideProcessBlock;
+
+    //marks the calling thread as processing audio until it goes out of scope, nests
+    struct ScopedProcessBlock
+    {
+        explicit ScopedProcessBlock(bool audited) : wasInside(insideProcessBlock)
+        {
+            insideProcessBlock = wasInside || audited;
+        }
+
+        ~ScopedProcessBlock()
+        {
+            insideProcessBlock = wasInside;
+        }
+
+        const bool wasInside;
+    };
+
+    int getViolationCount(); //every kind, since the last reset
+    int getViolationCount(Kind kind);
+    const char* getLastViolation(Kind kind); //the function that was called, nullptr if none was
+    const char* getKindName(Kind kind);
+    void resetViolationCounts();
+}
+
+#endif
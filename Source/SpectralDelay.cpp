@@ -0,0 +1,313 @@
+/*
+  ==============================================================================
+
+    SpectralDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralDelay.h"
+
+//==============================================================================
+SpectralDelay::SpectralDelay()
+{
+    mSampleRate = 0;
+    mFFTSize = 0;
+    mHopSize = 0;
+    mBaseHopSize = 0;
+    mPendingHopSize = 0;
+    mNumBins = 0;
+    mHopPosition = 0;
+    mRenormaliseSamples = 0;
+    mNumSlots = 0;
+    mMaxSlotDistance = 0;
+    mFrameWriteIndex = 0;
+    mFrameTime = 0;
+    mFirstFrameTime = 0;
+
+    mDelayTimeSeconds = 0;
+    mFeedback = 0;
+    mTilt = 0;
+    mOutputScale = 0;
+    mBinParametersChanged = false;
+}
+
+void SpectralDelay::prepare(double sampleRate, int fftOrder, int hopSize, double maxDelaySeconds)
+{
+    const int fftSize = 1 << fftOrder;
+    const int baseHopSize = juce::jlimit(1, fftSize, hopSize);
+
+    //one slot per base hop of time. Frames run a hop apart, so whatever time a bin asks for, there's a frame
+    //no more than half the longest hop away - the slots for that much either side come on top of the delay
+    const int maxSlotDistance = juce::jmax(1, fftSize / 2 / baseHopSize) / 2;
+    const int numSlots = (int)std::ceil(maxDelaySeconds * sampleRate / baseHopSize) + 1 + maxSlotDistance;
+
+    //nothing to rebuild when the host re-prepares with the same settings, and the delayed spectra carry on
+    if(sampleRate == mSampleRate && fftSize == mFFTSize && baseHopSize == mBaseHopSize && numSlots == mNumSlots){
+        return;
+    }
+
+    mSampleRate = sampleRate;
+    mFFTSize = fftSize;
+    mHopSize = baseHopSize;
+    mBaseHopSize = mHopSize;
+    mPendingHopSize = mHopSize;
+    mNumBins = mFFTSize / 2 + 1;
+
+    if(mFFT == nullptr || mFFT->getSize() != mFFTSize){
+        mFFT = std::make_unique<juce::dsp::FFT>(fftOrder);
+    }
+
+    //sqrt-Hann on both analysis and synthesis multiplies out to a Hann window,
+    //which overlap-adds to a constant for any hop that divides mFFTSize / 2
+    mWindow.resize(mFFTSize);
+    mOverlapWindow.resize(mFFTSize);
+
+    for(int n = 0; n < mFFTSize; n++){
+        mOverlapWindow[n] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * n / mFFTSize);
+        mWindow[n] = std::sqrt(mOverlapWindow[n]);
+    }
+
+    mOutputScale = 2.0f * mHopSize / mFFTSize;
+
+    mInputFrame.resize(mFFTSize);
+    mOutputAccumulator.resize(mFFTSize);
+    mWindowAccumulator.resize(mFFTSize);
+    mFFTData.resize(2 * mFFTSize);
+
+    //sized for the base hop, so larger hops from setHopMultiplier() just leave slots in between unused
+    mNumSlots = numSlots;
+    mMaxSlotDistance = maxSlotDistance;
+
+    mFrameRing.malloc(mNumSlots * mNumBins * 2);
+    mSlotTimes.malloc(mNumSlots);
+    std::fill(mSlotTimes.get(), mSlotTimes.get() + mNumSlots, (juce::int64)-1);
+    mFrameWriteIndex = 0;
+    mFrameTime = 0;
+
+    mDelayedSpectrum.resize(mNumBins * 2);
+    mFeedbackSpectrum.resize(mNumBins * 2);
+    mBinTiltPosition.resize(mNumBins);
+    mBinOutputSlots.resize(mNumBins);
+    mBinFeedbackSlots.resize(mNumBins);
+    mBinFeedback.resize(mNumBins * 2);
+
+    //-1 at ~31Hz, 0 at 1kHz, +1 at ~32kHz - only depends on the sample rate, so it's worked out once here
+    for(int bin = 0; bin < mNumBins; bin++){
+        float binFrequency = juce::jmax(20.0f, (float)(bin * mSampleRate / mFFTSize));
+        mBinTiltPosition[bin] = juce::jlimit(-1.0f, 1.0f, std::log2(binFrequency / 1000.0f) / 5.0f);
+    }
+
+    updateBinParameters();
+    reset();
+}
+
+void SpectralDelay::reset()
+{
+    std::fill(mInputFrame.begin(), mInputFrame.end(), 0.0f);
+    std::fill(mOutputAccumulator.begin(), mOutputAccumulator.end(), 0.0f);
+    std::fill(mWindowAccumulator.begin(), mWindowAccumulator.end(), 0.0f);
+
+    //the ring can be a couple of megabytes, so rather than clearing it the frames are just forgotten
+    mHopPosition = 0;
+    mRenormaliseSamples = 0;
+    mFirstFrameTime = mFrameTime;
+}
+
+void SpectralDelay::setParameters(float delayTimeSeconds, float feedback, float tilt)
+{
+    if(delayTimeSeconds == mDelayTimeSeconds && feedback == mFeedback && tilt == mTilt){
+        return;
+    }
+
+    mDelayTimeSeconds = delayTimeSeconds;
+    mFeedback = feedback;
+    mTilt = tilt;
+    mBinParametersChanged = true;
+}
+
+void SpectralDelay::setHopMultiplier(int multiplier)
+{
+    mPendingHopSize = juce::jlimit(mBaseHopSize, juce::jmax(mBaseHopSize, mFFTSize / 2), mBaseHopSize * multiplier);
+
+    //straight after a reset there's nothing overlapping yet, so the first frame can already be at the new hop
+    if(mHopPosition == 0 && mFrameTime == mFirstFrameTime && mPendingHopSize != mHopSize){
+        mHopSize = mPendingHopSize;
+        mOutputScale = 2.0f * mHopSize / mFFTSize;
+        mBinParametersChanged = true;
+    }
+}
+
+void SpectralDelay::updateBinParameters()
+{
+    if(mNumBins == 0){
+        return;
+    }
+
+    //the STFT itself adds one frame of latency, which only the output tap has to make up for
+    const float latencySamples = (float)mFFTSize;
+
+    //delays are whole hops, so once the hop has settled every bin lands exactly on a frame. The last frame
+    //written is one hop back, and the ring has to hold the nearest frame either side of the longest delay
+    const int hopSlots = mHopSize / mBaseHopSize;
+    const int maxSlots = mNumSlots - 1 - mMaxSlotDistance;
+
+    for(int bin = 0; bin < mNumBins; bin++){
+        const float position = mBinTiltPosition[bin];
+
+        //positive tilt gives the highs longer delays and more feedback, negative tilt the lows
+        float binDelaySamples = mDelayTimeSeconds * std::exp2(mTilt * position) * (float)mSampleRate;
+        mBinOutputSlots[bin] = juce::jlimit(hopSlots, maxSlots, hopSlots * juce::roundToInt((binDelaySamples - latencySamples) / mHopSize));
+        mBinFeedbackSlots[bin] = juce::jlimit(hopSlots, maxSlots, hopSlots * juce::roundToInt(binDelaySamples / mHopSize));
+
+        float binFeedback = juce::jlimit(0.0f, 0.98f, mFeedback * (1.0f + 0.5f * mTilt * position));
+        mBinFeedback[2 * bin] = binFeedback;
+        mBinFeedback[2 * bin + 1] = binFeedback;
+    }
+
+    mBinParametersChanged = false;
+}
+
+void SpectralDelay::process(float* channelData, int numSamples, float dryWet)
+{
+    if(mFFT == nullptr){
+        return;
+    }
+
+    for(int i = 0; i < numSamples; i++){
+
+        float drySample = channelData[i];
+        mInputFrame[mFFTSize - mHopSize + mHopPosition] = drySample;
+
+        float wetSample = mOutputAccumulator[mHopPosition];
+
+        //frames from either side of a hop change don't overlap-add to one, so divide out what they do add to
+        if(mRenormaliseSamples > 0){
+            wetSample /= juce::jmax(0.25f, mWindowAccumulator[mHopPosition]);
+            mRenormaliseSamples--;
+        }
+
+        channelData[i] = drySample * (1 - dryWet) + wetSample * dryWet;
+
+        if(++mHopPosition == mHopSize){
+            processFrame();
+            mHopPosition = 0;
+
+            //the hop changes before the input frame slides along, so the next hop's input lands at the end of the frame
+            if(mPendingHopSize != mHopSize){
+                changeHopSize(mPendingHopSize);
+            }
+
+            //the next frame is taken one (new) hop from now
+            mFrameTime += mHopSize / mBaseHopSize;
+            mFrameWriteIndex += mHopSize / mBaseHopSize;
+
+            if(mFrameWriteIndex >= mNumSlots){
+                mFrameWriteIndex -= mNumSlots;
+            }
+
+            if(mBinParametersChanged){
+                updateBinParameters();
+            }
+
+            std::copy(mInputFrame.begin() + mHopSize, mInputFrame.end(), mInputFrame.begin());
+        }
+    }
+}
+
+void SpectralDelay::changeHopSize(int newHopSize)
+{
+    //the ring stays as it is - frames are filed by the time they were taken, so the delayed ones are found
+    //at the same times whatever the hop, and the change costs no more than any other hop
+    mHopSize = newHopSize;
+    mOutputScale = 2.0f * mHopSize / mFFTSize;
+    mRenormaliseSamples = mFFTSize;
+    mBinParametersChanged = true;
+}
+
+const float* SpectralDelay::findDelayedBin(int slotsBack, int bin) const
+{
+    //slots that haven't been written since the last reset, or were skipped by a longer hop, read as silence
+    static constexpr float silentBin[2] = { 0.0f, 0.0f };
+
+    const int binOffset = 2 * bin;
+    const juce::int64 time = mFrameTime - slotsBack;
+
+    if(time < mFirstFrameTime){
+        return silentBin;
+    }
+
+    int slot = mFrameWriteIndex - slotsBack;
+
+    if(slot < 0){
+        slot += mNumSlots;
+    }
+
+    //the slot for the exact time, and failing that the nearest written one, the older side first
+    for(int distance = 0; distance <= mMaxSlotDistance; distance++){
+        int olderSlot = slot - distance;
+
+        if(olderSlot < 0){
+            olderSlot += mNumSlots;
+        }
+
+        if(mSlotTimes[olderSlot] == time - distance && time - distance >= mFirstFrameTime){
+            return &mFrameRing[olderSlot * mNumBins * 2 + binOffset];
+        }
+
+        int newerSlot = slot + distance;
+
+        if(newerSlot >= mNumSlots){
+            newerSlot -= mNumSlots;
+        }
+
+        if(distance > 0 && mSlotTimes[newerSlot] == time + distance){
+            return &mFrameRing[newerSlot * mNumBins * 2 + binOffset];
+        }
+    }
+
+    return silentBin;
+}
+
+void SpectralDelay::processFrame()
+{
+    const int binStride = mNumBins * 2;
+
+    //analysis
+    juce::FloatVectorOperations::multiply(mFFTData.data(), mInputFrame.data(), mWindow.data(), mFFTSize);
+    juce::FloatVectorOperations::clear(mFFTData.data() + mFFTSize, mFFTSize);
+    mFFT->performRealOnlyForwardTransform(mFFTData.data(), true);
+
+    //gather each bin from the frames it's delayed by - one pass over the ring
+    for(int bin = 0; bin < mNumBins; bin++){
+        const float* outputBin = findDelayedBin(mBinOutputSlots[bin], bin);
+        const float* feedbackBin = findDelayedBin(mBinFeedbackSlots[bin], bin);
+
+        mDelayedSpectrum[2 * bin] = outputBin[0];
+        mDelayedSpectrum[2 * bin + 1] = outputBin[1];
+        mFeedbackSpectrum[2 * bin] = feedbackBin[0];
+        mFeedbackSpectrum[2 * bin + 1] = feedbackBin[1];
+    }
+
+    //the new frame is the input spectrum plus the per-bin feedback of the delayed one,
+    //done as one vectorised multiply-add over the interleaved complex values
+    float* ringFrame = &mFrameRing[mFrameWriteIndex * binStride];
+    juce::FloatVectorOperations::copy(ringFrame, mFFTData.data(), binStride);
+    juce::FloatVectorOperations::addWithMultiply(ringFrame, mFeedbackSpectrum.data(), mBinFeedback.data(), binStride);
+    mSlotTimes[mFrameWriteIndex] = mFrameTime;
+
+    //synthesis
+    juce::FloatVectorOperations::copy(mFFTData.data(), mDelayedSpectrum.data(), binStride);
+    juce::FloatVectorOperations::clear(mFFTData.data() + binStride, 2 * mFFTSize - binStride);
+    mFFT->performRealOnlyInverseTransform(mFFTData.data());
+    juce::FloatVectorOperations::multiply(mFFTData.data(), mWindow.data(), mFFTSize);
+
+    //the first hop of the accumulator has been played, slide everything along before adding the new frame
+    std::copy(mOutputAccumulator.begin() + mHopSize, mOutputAccumulator.end(), mOutputAccumulator.begin());
+    std::fill(mOutputAccumulator.end() - mHopSize, mOutputAccumulator.end(), 0.0f);
+    juce::FloatVectorOperations::addWithMultiply(mOutputAccumulator.data(), mFFTData.data(), mOutputScale, mFFTSize);
+
+    std::copy(mWindowAccumulator.begin() + mHopSize, mWindowAccumulator.end(), mWindowAccumulator.begin());
+    std::fill(mWindowAccumulator.end() - mHopSize, mWindowAccumulator.end(), 0.0f);
+    juce::FloatVectorOperations::addWithMultiply(mWindowAccumulator.data(), mOverlapWindow.data(), mOutputScale, mFFTSize);
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    SpectralDelay.h
+
+    Short-time FFT delay where every frequency bin has its own delay time and
+    feedback amount, shaped by a tilt curve across the spectrum.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/**
+    Processes one channel. The analysis/synthesis runs with sqrt-Hann windows and
+    overlap-add, and the delayed spectra live in one contiguous frame ring indexed
+    by [slot][bin], so every hop is a single gather over the bins. There is one
+    slot per base hop of time and each frame is filed by when it was taken, so
+    the hop can change without moving anything in the ring.
+
+    All memory is allocated in prepare() - process() never allocates. The frame
+    ring is never cleared: frames from before the last reset() are read as
+    silence instead, so resetting costs the same however long the delay is.
+*/
+class SpectralDelay
+{
+public:
+    SpectralDelay();
+
+    void prepare(double sampleRate, int fftOrder, int hopSize, double maxDelaySeconds);
+    void reset();
+
+    //per-bin delay times and feedback are recalculated at the next frame boundary,
+    //and only if something changed, so moving a control costs at most one pass over the bins per hop
+    void setParameters(float delayTimeSeconds, float feedback, float tilt);
+
+    //runs the frames at a multiple of the prepared hop size (fewer FFTs per second),
+    //takes effect at the next frame boundary. Each bin reads whichever frame is nearest its
+    //delay, so the echoes keep their timing across the change, and the overlap-add is
+    //renormalised while frames at both spacings overlap
+    void setHopMultiplier(int multiplier);
+
+    //runs the spectral delay in place, mixing the delayed signal with the dry input
+    void process(float* channelData, int numSamples, float dryWet);
+
+    int getFFTSize() const { return mFFTSize; }
+
+private:
+    void processFrame();
+    void updateBinParameters();
+    void changeHopSize(int newHopSize);
+    const float* findDelayedBin(int slotsBack, int bin) const;
+
+    std::unique_ptr<juce::dsp::FFT> mFFT;
+
+    double mSampleRate;
+    int mFFTSize;
+    int mHopSize;
+    int mBaseHopSize;
+    int mPendingHopSize;
+    int mNumBins;
+
+    std::vector<float> mWindow;
+    std::vector<float> mOverlapWindow; //the analysis and synthesis windows multiplied, what each frame adds to the overlap
+    std::vector<float> mInputFrame; //last mFFTSize input samples
+    std::vector<float> mOutputAccumulator; //overlap-add sum of the synthesised frames
+    std::vector<float> mWindowAccumulator; //overlap-add sum of the windows, to renormalise after a hop change
+    int mRenormaliseSamples; //how much of the output still overlaps frames from before the last hop change
+    std::vector<float> mFFTData; //interleaved complex scratch, 2 * mFFTSize
+    int mHopPosition;
+
+    juce::HeapBlock<float> mFrameRing; //mNumSlots * mNumBins interleaved complex values, left uninitialised
+    juce::HeapBlock<juce::int64> mSlotTimes; //when the frame in each slot was taken, in base hops, -1 if never written
+    std::vector<float> mDelayedSpectrum; //what gets played this hop
+    std::vector<float> mFeedbackSpectrum; //what gets fed back into the ring this hop
+    int mNumSlots;
+    int mMaxSlotDistance; //how far the nearest frame can be from any time, half the longest hop in slots
+    int mFrameWriteIndex; //the slot for mFrameTime
+    juce::int64 mFrameTime; //when the frame being taken next is, in base hops - only ever counts up
+    juce::int64 mFirstFrameTime; //frames from before this, the last reset, read as silence
+
+    std::vector<float> mBinTiltPosition; //where each bin sits on the tilt curve, -1 to +1
+    std::vector<int> mBinOutputSlots; //delay minus the STFT latency in base hops, so the first echo lands on time
+    std::vector<int> mBinFeedbackSlots; //the full delay, so the repeats keep the same spacing
+    std::vector<float> mBinFeedback; //duplicated for the real and imaginary parts
+
+    float mDelayTimeSeconds;
+    float mFeedback;
+    float mTilt;
+    float mOutputScale;
+    bool mBinParametersChanged;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralDelay)
+};
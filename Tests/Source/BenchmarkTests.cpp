@@ -0,0 +1,285 @@
+/*
+  ==============================================================================
+
+    BenchmarkTests.cpp
+
+    Times each processing path on the calling thread only and gates on its
+    ns/sample against the committed baseline, BenchmarkBaseline.txt next to
+    Tests.jucer, which has to be recorded on the machine that runs the gate.
+    The delay kernel's specialised variants are timed the same way, against
+    the one that does all the work, and the grain engine is timed on its own
+    with every grain in its pool playing.
+
+  ==============================================================================
+*/
+
+#include "RenderHarness.h"
+#include "TestSettings.h"
+#include "TestSignals.h"
+#include "../../Source/GrainEngine.h"
+
+#include <limits>
+#include <map>
+
+namespace
+{
+    const double benchmarkSampleRate = 48000.0;
+    const int benchmarkBlockSize = 512;
+    const int benchmarkChannels = 2;
+    const double benchmarkSeconds = 2.0;
+    const int benchmarkRuns = 5; // the fastest run is kept, the others are mostly scheduler noise
+
+    struct BenchmarkPath
+    {
+        const char* name;
+        bool nonRealtime;
+        std::vector<ParameterValue> values;
+        std::vector<ParameterRamp> ramps;
+    };
+
+    const std::vector<BenchmarkPath>& getBenchmarkPaths()
+    {
+        static const std::vector<BenchmarkPath> paths
+        {
+            { "delay",           false, { { "mode", 0 }, { "feedback", 0.5f }, { "dryWet", 0.5f } } },
+            { "delay (offline)", true,  { { "mode", 0 }, { "feedback", 0.5f }, { "dryWet", 0.5f } } },
+            { "spectral",        false, { { "mode", 1 }, { "feedback", 0.5f }, { "dryWet", 0.5f }, { "spectralTilt", 0.5f } } },
+            { "reverse",         false, { { "mode", 2 }, { "feedback", 0.3f }, { "dryWet", 0.5f } } },
+            { "granular",        false, { { "mode", 3 }, { "feedback", 0.3f }, { "dryWet", 0.5f }, { "grainSize", 0.05f },
+                                          { "grainDensity", 40.0f }, { "grainJitter", 0.5f }, { "grainPitch", 1.5f } } }
+        };
+
+        return paths;
+    }
+
+    // The delay kernel variants, picked per block from the same snapshot the plugin takes. The delay
+    // time is ramped in every one of them, so each pays the same per-block parameter cost, but only
+    // in the moving ones does the target ever change. All use the realtime (linear) interpolation;
+    // the offline cubic profile is the "delay (offline)" path above, and the governor's tier without
+    // interpolation can't be selected from outside.
+    const ParameterRamp moving { "delayTime", 0.2f, 0.3f };
+    const ParameterRamp staticDelay { "delayTime", 0.25f, 0.25f };
+
+    const std::vector<BenchmarkPath>& getKernelVariants()
+    {
+        static const std::vector<BenchmarkPath> variants
+        {
+            // Everything on - the others are reported as a speedup over this one
+            { "blend, moving, feedback",       false, { { "mode", 0 }, { "feedback", 0.5f }, { "dryWet", 0.5f } }, { moving } },
+            { "blend, moving, no feedback",    false, { { "mode", 0 }, { "feedback", 0.0f }, { "dryWet", 0.5f } }, { moving } },
+            { "blend, static, feedback",       false, { { "mode", 0 }, { "feedback", 0.5f }, { "dryWet", 0.5f } }, { staticDelay } },
+            { "blend, static, no feedback",    false, { { "mode", 0 }, { "feedback", 0.0f }, { "dryWet", 0.5f } }, { staticDelay } },
+            { "wet only, static, feedback",    false, { { "mode", 0 }, { "feedback", 0.5f }, { "dryWet", 1.0f } }, { staticDelay } },
+            { "wet only, static, no feedback", false, { { "mode", 0 }, { "feedback", 0.0f }, { "dryWet", 1.0f } }, { staticDelay } },
+            { "dry only, static, no feedback", false, { { "mode", 0 }, { "feedback", 0.0f }, { "dryWet", 0.0f } }, { staticDelay } }
+        };
+
+        return variants;
+    }
+}
+
+//==============================================================================
+class BenchmarkTests  : public juce::UnitTest
+{
+public:
+    BenchmarkTests() : juce::UnitTest ("Benchmark", "Benchmark") {}
+
+    void runTest() override
+    {
+        beginTest ("ns per channel-sample, single-threaded");
+
+        auto& settings = getTestSettings();
+        auto baseline = readBaseline (settings.baselineFile);
+        juce::StringArray newBaseline;
+
+        for (auto& path : getBenchmarkPaths())
+        {
+            auto nanoseconds = measure (path);
+            logMessage (juce::String (path.name).paddedRight (' ', 20) + juce::String (nanoseconds, 2) + " ns");
+            newBaseline.add (juce::String (path.name) + "=" + juce::String (nanoseconds, 3));
+
+            checkAgainstBaseline (baseline, path.name, nanoseconds);
+        }
+
+        beginTest ("delay kernel variants, ns per channel-sample");
+
+        auto& variants = getKernelVariants();
+        auto fullKernelNanoseconds = 0.0;
+
+        for (auto& variant : variants)
+        {
+            auto nanoseconds = measure (variant);
+            auto name = "delay kernel: " + juce::String (variant.name);
+            auto line = juce::String (variant.name).paddedRight (' ', 32) + juce::String (nanoseconds, 2) + " ns";
+
+            if (&variant == &variants.front())
+            {
+                fullKernelNanoseconds = nanoseconds;
+            }
+            else
+            {
+                line << "  " << juce::String (fullKernelNanoseconds / nanoseconds, 2) << "x";
+
+                // A variant that skips work but isn't faster has lost its specialisation or its dispatch
+                expect (nanoseconds <= fullKernelNanoseconds * (1.0 + settings.maxRegression),
+                        name + " is slower than " + variants.front().name);
+            }
+
+            logMessage (line);
+            newBaseline.add (name + "=" + juce::String (nanoseconds, 3));
+
+            checkAgainstBaseline (baseline, name, nanoseconds);
+        }
+
+        beginTest ("grain engine, full pool");
+
+        {
+            auto averageGrains = 0.0;
+            auto nanoseconds = measureFullGrainPool (averageGrains);
+            auto name = "grain engine: " + juce::String (GrainEngine::maxGrains) + " grains";
+
+            logMessage (name.paddedRight (' ', 32) + juce::String (nanoseconds, 2) + " ns per stereo sample, "
+                          + juce::String (nanoseconds * benchmarkSampleRate * 1.0e-7, 2) + "% of a core at "
+                          + juce::String (benchmarkSampleRate / 1000.0, 0) + " kHz (" + juce::String (averageGrains, 1) + " grains on average)");
+            newBaseline.add (name + "=" + juce::String (nanoseconds, 3));
+
+            expect (averageGrains >= GrainEngine::maxGrains - 1.0, "the pool wasn't full, only " + juce::String (averageGrains, 1) + " grains played on average");
+            checkAgainstBaseline (baseline, name, nanoseconds);
+        }
+
+        if (settings.newBaselineFile != juce::File())
+            expect (settings.newBaselineFile.replaceWithText (newBaseline.joinIntoString ("\n") + "\n"),
+                    "couldn't write " + settings.newBaselineFile.getFullPathName());
+    }
+
+private:
+    // Renders noise through one path and returns the best time per channel-sample. Only the calling
+    // thread is used (no channel workers, no governor), so the numbers are comparable between runs
+    double measure (const BenchmarkPath& path)
+    {
+        RenderHarness harness (benchmarkChannels, benchmarkSampleRate, benchmarkBlockSize, path.nonRealtime);
+        harness.setParameters (path.values);
+        harness.setParameters ({ { "governor", 0 }, { "multithread", 0 }, { "sync", 0 } });
+
+        juce::AudioBuffer<float> input (benchmarkChannels, (int) (benchmarkSeconds * benchmarkSampleRate));
+        TestSignals::generate (TestSignals::Signal::noise, input, benchmarkSampleRate);
+        juce::AudioBuffer<float> buffer (input.getNumChannels(), input.getNumSamples());
+
+        const std::vector<int> blockSizes { benchmarkBlockSize };
+        auto bestSeconds = std::numeric_limits<double>::max();
+
+        // One extra run first, so the delay lines have been written and the caches are warm
+        for (int run = 0; run <= benchmarkRuns; ++run)
+        {
+            buffer.makeCopyOf (input, true);
+
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            harness.render (buffer, blockSizes, path.ramps);
+            auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+            if (run > 0)
+                bestSeconds = juce::jmin (bestSeconds, seconds);
+        }
+
+        return bestSeconds * 1.0e9 / ((double) input.getNumSamples() * input.getNumChannels());
+    }
+
+    // Times GrainEngine::renderSample alone, stereo, with grains asked for faster than they finish so
+    // the pool stays full - the plugin's own parameter ranges top out at 50 overlapping grains
+    double measureFullGrainPool (double& averageGrains)
+    {
+        const int bufferLength = (int) benchmarkSampleRate * MAX_DELAY_LINE_TIME;
+        const float grainSizeSeconds = 0.5f;
+        const float grainsPerSecond = 1.25f * GrainEngine::maxGrains / grainSizeSeconds;
+
+        juce::AudioBuffer<float> delayLines (benchmarkChannels, bufferLength);
+        TestSignals::generate (TestSignals::Signal::noise, delayLines, benchmarkSampleRate);
+
+        GrainEngine engine;
+        engine.prepare (benchmarkSampleRate);
+        engine.setParameters (0.1f * (float) benchmarkSampleRate, grainSizeSeconds, grainsPerSecond, 0.5f, 1.5f, false, bufferLength);
+
+        const auto numSamples = (int) (benchmarkSeconds * benchmarkSampleRate);
+        auto* const* buffers = delayLines.getArrayOfReadPointers();
+        float outputs[benchmarkChannels];
+        int writeHead = 0;
+
+        auto render = [&] (int samples)
+        {
+            for (int i = 0; i < samples; ++i)
+            {
+                engine.renderSample (buffers, benchmarkChannels, bufferLength, writeHead, outputs);
+                writeHead = writeHead + 1 == bufferLength ? 0 : writeHead + 1;
+            }
+        };
+
+        render ((int) (grainSizeSeconds * benchmarkSampleRate) * 2); // fill the pool first
+
+        auto bestSeconds = std::numeric_limits<double>::max();
+        auto grainCount = 0.0;
+        auto numCounts = 0;
+
+        for (int run = 0; run < benchmarkRuns; ++run)
+        {
+            auto startTicks = juce::Time::getHighResolutionTicks();
+
+            // in blocks, so the grain count can be sampled outside the timed loop without costing much
+            for (int position = 0; position < numSamples; position += benchmarkBlockSize)
+            {
+                render (juce::jmin (benchmarkBlockSize, numSamples - position));
+                grainCount += engine.getNumActiveGrains();
+                ++numCounts;
+            }
+
+            bestSeconds = juce::jmin (bestSeconds, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks));
+        }
+
+        averageGrains = grainCount / numCounts;
+        return bestSeconds * 1.0e9 / numSamples;
+    }
+
+    void checkAgainstBaseline (const std::map<juce::String, double>& baseline, const juce::String& name, double nanoseconds)
+    {
+        auto entry = baseline.find (name);
+
+        if (entry == baseline.end())
+        {
+            // a missing file has been reported already, and a run recording a baseline is adding the path
+            expect (baseline.empty() || getTestSettings().newBaselineFile != juce::File(),
+                    "no timing for " + name + " in the baseline (record it with --write-baseline)");
+            return;
+        }
+
+        auto limit = entry->second * (1.0 + getTestSettings().maxRegression);
+
+        expect (nanoseconds <= limit, name + " takes " + juce::String (nanoseconds, 2) + " ns per channel-sample, the baseline allows "
+                                        + juce::String (limit, 2) + " (" + juce::String (entry->second, 2) + " recorded)");
+    }
+
+    // One "path=ns" line per path, as written by --write-baseline
+    std::map<juce::String, double> readBaseline (const juce::File& file)
+    {
+        std::map<juce::String, double> baseline;
+
+        // Only a run that records a baseline can do without one
+        if (! file.existsAsFile())
+        {
+            expect (getTestSettings().newBaselineFile != juce::File(),
+                    "no baseline at " + file.getFullPathName() + " (record one with --write-baseline)");
+            return baseline;
+        }
+
+        juce::StringArray lines;
+        lines.addLines (file.loadFileAsString());
+
+        for (auto& line : lines)
+            if (line.containsChar ('='))
+                baseline[line.upToLastOccurrenceOf ("=", false, false).trim()] = line.fromLastOccurrenceOf ("=", false, false).getDoubleValue();
+
+        expect (! baseline.empty(), "no timings in the baseline " + file.getFullPathName());
+
+        return baseline;
+    }
+};
+
+static BenchmarkTests benchmarkTests;
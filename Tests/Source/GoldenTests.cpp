@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+    GoldenTests.cpp
+
+    Renders every test signal through every mode and compares the result with
+    the golden render stored in Tests/Goldens, within a tolerance per mode.
+    Every case is rendered again on a wide bus with the channel workers on,
+    which has to give exactly what it gives without them.
+
+  ==============================================================================
+*/
+
+#include "RenderHarness.h"
+#include "TestSettings.h"
+#include "TestSignals.h"
+
+namespace
+{
+    const double goldenSampleRate = 48000.0;
+    const double goldenSeconds = 0.5;
+
+    // Includes the empty and single-sample blocks hosts do send, and sizes that don't divide
+    // the spectral hop, so block boundaries land everywhere
+    const std::vector<int> goldenBlockSizes { 512, 0, 1, 256, 37, 1024, 129 };
+
+    // Four groups of channels, so up to three workers and the audio thread share them
+    const int multichannelChannels = 4 * MIN_CHANNELS_PER_GROUP;
+
+    struct ModeCase
+    {
+        const char* name;
+        float tolerance;            // largest sample difference from the golden that still passes
+        float automationTolerance;  // the same for the automation signal
+        std::vector<ParameterValue> values;
+        std::vector<ParameterRamp> ramps; // for the automation signal
+        bool nonRealtime = false;         // the offline render profile, as a bounce
+        double bpm = 0.0;                 // the host tempo for synced cases, 0 for no play head
+        double windowStartSeconds = 0.0;  // the golden only keeps goldenSeconds of the render from here
+    };
+
+    // The delay, reverse and granular paths are plain arithmetic on the samples, so they only
+    // move by rounding. The spectral path goes through juce::dsp::FFT, whose engine differs by
+    // platform (and in its last bits by build), and keeps feeding that back into itself.
+    // Grain jitter stays at 0, so the goldens don't depend on juce::Random's sequence.
+    // Ramped parameters go through float arithmetic in JUCE's range conversions, which a compiler
+    // may contract into FMAs, so a ramped delay time can land one float step (~1.4e-3 samples at
+    // 0.3 s and 48 kHz) away - on noise that moves the read by up to ~7e-4. The spectral path
+    // rounds its delays to whole frames, so it doesn't see that.
+    // The offline cases use the Hermite interpolation of the offline profile instead of linear.
+    // The synced cases are the delay mode again, with its time taken from a note value at the
+    // host tempo - the second at exactly the longest delay the lines hold, where the read head
+    // is closest to wrapping onto the write head, so its golden is the stretch after that delay.
+    const std::vector<ModeCase>& getModeCases()
+    {
+        static const std::vector<ModeCase> modeCases
+        {
+            { "delay", 1.0e-5f, 1.0e-3f,
+              { { "mode", 0 }, { "delayTime", 0.1f }, { "feedback", 0.5f }, { "dryWet", 0.5f } },
+              { { "delayTime", 0.1f, 0.3f }, { "feedback", 0.2f, 0.8f }, { "dryWet", 0.3f, 1.0f } } },
+
+            { "spectral", 1.0e-4f, 1.0e-4f,
+              { { "mode", 1 }, { "delayTime", 0.1f }, { "feedback", 0.5f }, { "dryWet", 0.5f }, { "spectralTilt", 0.5f } },
+              { { "delayTime", 0.1f, 0.3f }, { "feedback", 0.2f, 0.8f }, { "spectralTilt", -1.0f, 1.0f } } },
+
+            { "reverse", 1.0e-5f, 1.0e-3f,
+              { { "mode", 2 }, { "delayTime", 0.1f }, { "feedback", 0.3f }, { "dryWet", 0.5f } },
+              { { "delayTime", 0.1f, 0.2f }, { "feedback", 0.0f, 0.6f }, { "dryWet", 0.3f, 1.0f } } },
+
+            { "granular", 1.0e-5f, 1.0e-3f,
+              { { "mode", 3 }, { "delayTime", 0.1f }, { "feedback", 0.3f }, { "dryWet", 0.5f },
+                { "grainSize", 0.05f }, { "grainDensity", 40.0f }, { "grainJitter", 0.0f }, { "grainPitch", 1.5f } },
+              { { "grainPitch", 0.5f, 2.0f }, { "grainSize", 0.02f, 0.1f }, { "grainDensity", 10.0f, 80.0f } } },
+
+            // A delay between samples, so the echoes actually go through the interpolation
+            { "delay_offline", 1.0e-5f, 1.0e-3f,
+              { { "mode", 0 }, { "delayTime", 0.1234f }, { "feedback", 0.5f }, { "dryWet", 0.5f } },
+              { { "delayTime", 0.1234f, 0.3f }, { "feedback", 0.2f, 0.8f }, { "dryWet", 0.3f, 1.0f } },
+              true },
+
+            { "granular_offline", 1.0e-5f, 1.0e-3f,
+              { { "mode", 3 }, { "delayTime", 0.1f }, { "feedback", 0.3f }, { "dryWet", 0.5f },
+                { "grainSize", 0.05f }, { "grainDensity", 40.0f }, { "grainJitter", 0.0f }, { "grainPitch", 1.5f } },
+              { { "grainPitch", 0.5f, 2.0f }, { "grainSize", 0.02f, 0.1f }, { "grainDensity", 10.0f, 80.0f } },
+              true },
+
+            // A dotted 1/16 at 120 bpm (0.1875 s), ramping to a dotted 1/8
+            { "sync", 1.0e-5f, 1.0e-3f,
+              { { "mode", 0 }, { "sync", 1 }, { "noteValue", 8 }, { "feedback", 0.5f }, { "dryWet", 0.5f } },
+              { { "noteValue", 8, 11 }, { "feedback", 0.2f, 0.8f }, { "dryWet", 0.3f, 1.0f } },
+              false, 120.0 },
+
+            // 4 bars of 4/4 at MIN_SYNC_TEMPO, which is MAX_SYNC_DELAY_TIME
+            { "sync_cap", 1.0e-5f, 1.0e-3f,
+              { { "mode", 0 }, { "sync", 1 }, { "noteValue", 25 }, { "feedback", 0.5f }, { "dryWet", 0.5f } },
+              { { "feedback", 0.2f, 0.8f }, { "dryWet", 0.3f, 1.0f } },
+              false, MIN_SYNC_TEMPO, MAX_SYNC_DELAY_TIME }
+        };
+
+        return modeCases;
+    }
+}
+
+//==============================================================================
+class GoldenRenderTests  : public juce::UnitTest
+{
+public:
+    GoldenRenderTests() : juce::UnitTest ("Golden renders", "DelayPlugIn") {}
+
+    void runTest() override
+    {
+        auto& settings = getTestSettings();
+
+        for (auto& modeCase : getModeCases())
+        {
+            for (int signalIndex = 0; signalIndex < TestSignals::numSignals; ++signalIndex)
+            {
+                auto signal = (TestSignals::Signal) signalIndex;
+                auto caseName = juce::String (modeCase.name) + "_" + TestSignals::getName (signal);
+
+                beginTest (caseName);
+
+                auto rendered = render (modeCase, signal, 1, false);
+                auto goldenFile = settings.goldenDirectory.getChildFile (caseName + ".wav");
+
+                if (settings.updateGoldens)
+                {
+                    expect (writeGolden (goldenFile, rendered), "couldn't write " + goldenFile.getFullPathName());
+                    continue;
+                }
+
+                juce::AudioBuffer<float> golden;
+
+                if (! readGolden (goldenFile, golden))
+                {
+                    expect (false, "no golden render at " + goldenFile.getFullPathName() + " (run with --update-goldens)");
+                    continue;
+                }
+
+                compare (rendered, golden, getTolerance (modeCase, signal));
+            }
+        }
+
+        // The workers only share out channels, so on a wide bus they mustn't change a single sample -
+        // and each channel must still come out as it does on its own, so the first matches the golden
+        for (auto& modeCase : getModeCases())
+        {
+            for (int signalIndex = 0; signalIndex < TestSignals::numSignals; ++signalIndex)
+            {
+                auto signal = (TestSignals::Signal) signalIndex;
+                auto caseName = juce::String (modeCase.name) + "_" + TestSignals::getName (signal);
+
+                beginTest (caseName + ", " + juce::String (multichannelChannels) + " channels multithreaded");
+
+                auto multithreaded = render (modeCase, signal, multichannelChannels, true);
+                auto singleThreaded = render (modeCase, signal, multichannelChannels, false);
+                compare (multithreaded, singleThreaded, 0.0f, "the single-threaded render");
+
+                juce::AudioBuffer<float> golden;
+
+                if (! settings.updateGoldens && readGolden (settings.goldenDirectory.getChildFile (caseName + ".wav"), golden))
+                {
+                    juce::AudioBuffer<float> firstChannel (multithreaded.getArrayOfWritePointers(), 1, multithreaded.getNumSamples());
+                    compare (firstChannel, golden, getTolerance (modeCase, signal));
+                }
+            }
+        }
+    }
+
+private:
+    static float getTolerance (const ModeCase& modeCase, TestSignals::Signal signal)
+    {
+        return signal == TestSignals::Signal::automation ? modeCase.automationTolerance : modeCase.tolerance;
+    }
+
+    static juce::AudioBuffer<float> render (const ModeCase& modeCase, TestSignals::Signal signal, int numChannels, bool multithreaded)
+    {
+        auto windowStart = (int) (modeCase.windowStartSeconds * goldenSampleRate);
+        auto numSamples = (int) (goldenSeconds * goldenSampleRate);
+        juce::AudioBuffer<float> buffer (numChannels, windowStart + numSamples);
+        TestSignals::generate (signal, buffer, goldenSampleRate);
+
+        // No governor, so the output is fully deterministic - the channel workers only decide which
+        // thread a channel is processed on
+        RenderHarness harness (numChannels, goldenSampleRate, 1024, modeCase.nonRealtime);
+        harness.setParameters ({ { "governor", 0 }, { "multithread", multithreaded ? 1.0f : 0.0f }, { "sync", 0 } });
+        harness.setParameters (modeCase.values);
+
+        // starts the smoothers on the case's delay time
+        if (modeCase.bpm > 0.0)
+            harness.restartAtTempo (modeCase.bpm);
+        else
+            harness.restart();
+
+        static const std::vector<ParameterRamp> noRamps;
+        harness.render (buffer, goldenBlockSizes, signal == TestSignals::Signal::automation ? modeCase.ramps : noRamps);
+
+        if (windowStart == 0)
+            return buffer;
+
+        juce::AudioBuffer<float> window (numChannels, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            window.copyFrom (channel, 0, buffer, channel, windowStart, numSamples);
+
+        return window;
+    }
+
+    void compare (const juce::AudioBuffer<float>& rendered, const juce::AudioBuffer<float>& expected, float tolerance,
+                  const juce::String& expectedName = "the golden")
+    {
+        expectEquals (rendered.getNumChannels(), expected.getNumChannels(), "channel count differs from " + expectedName);
+        expectEquals (rendered.getNumSamples(), expected.getNumSamples(), "length differs from " + expectedName);
+
+        auto numChannels = juce::jmin (rendered.getNumChannels(), expected.getNumChannels());
+        auto numSamples = juce::jmin (rendered.getNumSamples(), expected.getNumSamples());
+
+        auto maxDifference = 0.0f;
+        auto worstSample = 0;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto difference = std::abs (rendered.getSample (channel, i) - expected.getSample (channel, i));
+
+                // NaNs fail the comparison below as well as here
+                if (! (difference <= maxDifference))
+                {
+                    maxDifference = difference;
+                    worstSample = i;
+                }
+            }
+        }
+
+        expect (maxDifference <= tolerance, "differs from " + expectedName + " by " + juce::String (maxDifference)
+                                              + " at sample " + juce::String (worstSample)
+                                              + " (tolerance " + juce::String (tolerance) + ")");
+    }
+
+    static bool writeGolden (const juce::File& file, const juce::AudioBuffer<float>& buffer)
+    {
+        file.getParentDirectory().createDirectory();
+        file.deleteFile();
+
+        std::unique_ptr<juce::FileOutputStream> stream (file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        // 32-bit WAV is stored as float, so the goldens keep every bit of the render
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor (stream.get(), goldenSampleRate,
+                                                                                    (unsigned int) buffer.getNumChannels(),
+                                                                                    32, {}, 0));
+
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); //the writer owns the stream now
+
+        return writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+    }
+
+    static bool readGolden (const juce::File& file, juce::AudioBuffer<float>& buffer)
+    {
+        if (! file.existsAsFile())
+            return false;
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatReader> reader (wavFormat.createReaderFor (file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+            return false;
+
+        buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        return reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+    }
+};
+
+static GoldenRenderTests goldenRenderTests;
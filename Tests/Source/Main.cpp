@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    Test runner: golden-render regression tests for every mode, and (with
+    --benchmark) a single-threaded benchmark that gates on ns/sample per path
+    against the committed baseline.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "TestSettings.h"
+
+#include <iostream>
+
+//==============================================================================
+TestSettings& getTestSettings()
+{
+    static TestSettings settings;
+    return settings;
+}
+
+// The goldens and the benchmark baseline live next to Tests.jucer, so look for it upwards from
+// the executable - that finds them from the Projucer build folders on every platform
+static juce::File findTestsDirectory()
+{
+    auto directory = juce::File::getSpecialLocation (juce::File::currentExecutableFile).getParentDirectory();
+
+    while (directory.getParentDirectory() != directory)
+    {
+        if (directory.getChildFile ("Tests.jucer").existsAsFile())
+            return directory;
+
+        directory = directory.getParentDirectory();
+    }
+
+    return juce::File::getCurrentWorkingDirectory();
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: Tests [options]" << std::endl
+              << std::endl
+              << "  --goldens <dir>          golden renders to compare with (default: Goldens next to Tests.jucer)" << std::endl
+              << "  --update-goldens         write this build's renders as the new goldens" << std::endl
+              << std::endl
+              << "  --benchmark              also time every processing path, single-threaded, and fail if" << std::endl
+              << "                           one is slower than recorded in the baseline..." << std::endl
+              << "  --max-regression <x>     ...by more than this fraction (default 0.25)" << std::endl
+              << "  --baseline <file>        the baseline (default: BenchmarkBaseline.txt next to Tests.jucer)" << std::endl
+              << "  --write-baseline <file>  record this run's timings, for this machine" << std::endl;
+}
+
+static int runCategory (juce::UnitTestRunner& runner, const juce::String& category)
+{
+    runner.runTestsInCategory (category);
+
+    auto numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult (i)->failures;
+
+    return numFailures;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+    auto& settings = getTestSettings();
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    auto testsDirectory = findTestsDirectory();
+
+    settings.goldenDirectory = args.containsOption ("--goldens") ? args.getFileForOption ("--goldens") : testsDirectory.getChildFile ("Goldens");
+    settings.updateGoldens = args.containsOption ("--update-goldens");
+    settings.runBenchmarks = args.containsOption ("--benchmark");
+    settings.baselineFile = args.containsOption ("--baseline") ? args.getFileForOption ("--baseline")
+                                                                : testsDirectory.getChildFile ("BenchmarkBaseline.txt");
+
+    if (args.containsOption ("--write-baseline"))
+        settings.newBaselineFile = args.getFileForOption ("--write-baseline");
+
+    if (args.containsOption ("--max-regression"))
+        settings.maxRegression = juce::jmax (0.0, args.getValueForOption ("--max-regression").getDoubleValue());
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+
+    auto numFailures = runCategory (runner, "DelayPlugIn");
+
+    if (settings.runBenchmarks)
+        numFailures += runCategory (runner, "Benchmark");
+
+    std::cout << std::endl << (numFailures == 0 ? "All tests passed" : juce::String (numFailures) + " failures") << std::endl;
+
+    return numFailures == 0 ? 0 : 1;
+}
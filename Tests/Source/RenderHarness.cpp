@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    RenderHarness.cpp
+
+  ==============================================================================
+*/
+
+#include "RenderHarness.h"
+
+#include <algorithm>
+
+//==============================================================================
+RenderHarness::RenderHarness (int numChannels, double rate, int blockSize, bool nonRealtime)
+    : sampleRate (rate), maxBlockSize (blockSize)
+{
+    auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add (channelSet);
+    layout.outputBuses.add (channelSet);
+
+    processor.setPlayHead (&playHead);
+    processor.setBusesLayout (layout);
+    processor.setRateAndBufferSizeDetails (sampleRate, maxBlockSize);
+    processor.setNonRealtime (nonRealtime);
+    processor.prepareToPlay (sampleRate, maxBlockSize);
+}
+
+RenderHarness::~RenderHarness()
+{
+    processor.releaseResources();
+}
+
+void RenderHarness::setParameter (const juce::String& parameterID, float value)
+{
+    auto* parameter = findParameter (parameterID);
+    jassert (parameter != nullptr); // the test refers to a parameter the processor doesn't have
+
+    if (parameter != nullptr)
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+}
+
+void RenderHarness::setParameters (const std::vector<ParameterValue>& values)
+{
+    for (auto& value : values)
+        setParameter (value.parameterID, value.value);
+}
+
+void RenderHarness::render (juce::AudioBuffer<float>& buffer, const std::vector<int>& blockSizes,
+                            const std::vector<ParameterRamp>& ramps)
+{
+    auto hasNonEmptyBlock = std::any_of (blockSizes.begin(), blockSizes.end(), [] (int size) { return size > 0; });
+    jassert (hasNonEmptyBlock); // a pattern of only empty blocks never gets through the buffer
+
+    if (! hasNonEmptyBlock)
+        return;
+
+    auto numChannels = buffer.getNumChannels();
+    auto totalSamples = buffer.getNumSamples();
+    juce::MidiBuffer midi;
+
+    size_t blockIndex = 0;
+
+    for (int position = 0; position < totalSamples;)
+    {
+        auto numSamples = juce::jmin (blockSizes[blockIndex++ % blockSizes.size()], maxBlockSize, totalSamples - position);
+
+        for (auto& ramp : ramps)
+        {
+            auto proportion = (float) position / (float) totalSamples;
+            setParameter (ramp.parameterID, ramp.startValue + (ramp.endValue - ramp.startValue) * proportion);
+        }
+
+        // The processor sees a buffer of exactly this block's size, as it would from a host
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, position, numSamples);
+        processor.processBlock (block, midi);
+
+        position += numSamples;
+    }
+}
+
+void RenderHarness::restart()
+{
+    processor.reset();
+}
+
+void RenderHarness::setTempo (double bpm, int timeSigNumerator, int timeSigDenominator)
+{
+    playHead.bpm = bpm;
+    playHead.timeSigNumerator = timeSigNumerator;
+    playHead.timeSigDenominator = timeSigDenominator;
+}
+
+void RenderHarness::restartAtTempo (double bpm, int timeSigNumerator, int timeSigDenominator)
+{
+    setTempo (bpm, timeSigNumerator, timeSigDenominator);
+
+    juce::AudioBuffer<float> silence (processor.getTotalNumOutputChannels(), 1);
+    silence.clear();
+    render (silence, { 1 });
+
+    restart();
+}
+
+juce::RangedAudioParameter* RenderHarness::findParameter (const juce::String& parameterID) const
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* rangedParameter = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            if (rangedParameter->paramID == parameterID)
+                return rangedParameter;
+
+    return nullptr;
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    RenderHarness.h
+
+    Runs DelayPlugInAudioProcessor the way a host would, without one: a fixed
+    bus layout and sample rate, parameters set through their normalised
+    host-facing values, and audio pushed through processBlock in blocks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#include <vector>
+
+//==============================================================================
+struct ParameterValue
+{
+    const char* parameterID;
+    float value;
+};
+
+// Moves a parameter in a straight line over a render, set at the start of every block
+struct ParameterRamp
+{
+    const char* parameterID;
+    float startValue;
+    float endValue;
+};
+
+//==============================================================================
+class RenderHarness
+{
+public:
+    // nonRealtime selects the processor's offline render profile, as a bounce would
+    RenderHarness (int numChannels, double sampleRate, int maxBlockSize, bool nonRealtime);
+    ~RenderHarness();
+
+    DelayPlugInAudioProcessor& getProcessor()   { return processor; }
+
+    // Plain (unnormalised) value, e.g. seconds for delayTime or an index for mode
+    void setParameter (const juce::String& parameterID, float value);
+    void setParameters (const std::vector<ParameterValue>& values);
+
+    // Processes buffer in place. Block sizes are taken from blockSizes in turn, repeating the
+    // pattern until the buffer is used up (0 is allowed and passed on as an empty block, but
+    // at least one size has to be bigger, or the buffer would never get used up).
+    // Ramps are applied before every block at the block's start position.
+    void render (juce::AudioBuffer<float>& buffer, const std::vector<int>& blockSizes,
+                 const std::vector<ParameterRamp>& ramps = {});
+
+    // Resets the processor the same way a host does when the transport restarts
+    void restart();
+
+    // Reports a tempo and time signature to the processor from then on - until this is called
+    // there's no position to report, as with a stopped host
+    void setTempo (double bpm, int timeSigNumerator = 4, int timeSigDenominator = 4);
+
+    // setTempo(), then one sample of silence so the processor hears the tempo (it's only read while
+    // processing), then restart() - so the smoothers start on the synced delay time
+    void restartAtTempo (double bpm, int timeSigNumerator = 4, int timeSigDenominator = 4);
+
+    double getSampleRate() const    { return sampleRate; }
+    int getMaxBlockSize() const     { return maxBlockSize; }
+
+private:
+    class FixedPlayHead  : public juce::AudioPlayHead
+    {
+    public:
+        bool getCurrentPosition (CurrentPositionInfo& result) override
+        {
+            if (bpm <= 0.0)
+                return false;
+
+            result.resetToDefault();
+            result.bpm = bpm;
+            result.timeSigNumerator = timeSigNumerator;
+            result.timeSigDenominator = timeSigDenominator;
+            return true;
+        }
+
+        double bpm = 0.0;
+        int timeSigNumerator = 4;
+        int timeSigDenominator = 4;
+    };
+
+    juce::RangedAudioParameter* findParameter (const juce::String& parameterID) const;
+
+    FixedPlayHead playHead;
+    DelayPlugInAudioProcessor processor;
+    double sampleRate;
+    int maxBlockSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderHarness)
+};
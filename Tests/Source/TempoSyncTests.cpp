@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    TempoSyncTests.cpp
+
+    Puts a single impulse through the delay mode with tempo sync on, and checks
+    that the echo lands exactly one note value later - including the longest
+    values at slow tempos, right up to and past what the delay lines hold.
+
+  ==============================================================================
+*/
+
+#include "RenderHarness.h"
+
+namespace
+{
+    const double syncSampleRate = 48000.0;
+
+    // Note value choices are triplet, straight and dotted in turn for each value
+    int noteValueIndex (int value, int modifier)    { return value * 3 + modifier; }
+
+    const int halfNote = 5;
+    const int fourBars = 8;
+    const int straight = 1;
+    const int dotted = 2;
+}
+
+//==============================================================================
+class TempoSyncTests  : public juce::UnitTest
+{
+public:
+    TempoSyncTests() : juce::UnitTest ("Tempo sync", "DelayPlugIn") {}
+
+    void runTest() override
+    {
+        beginTest ("dotted half at 60 bpm");
+        checkEcho (60.0, 4, noteValueIndex (halfNote, dotted), 3.0);
+
+        beginTest ("4 bars at 60 bpm, the longest delay");
+        checkEcho (60.0, 4, noteValueIndex (fourBars, straight), MAX_SYNC_DELAY_TIME);
+
+        beginTest ("dotted 4 bars at 90 bpm, just inside the cap");
+        checkEcho (90.0, 4, noteValueIndex (fourBars, dotted), MAX_SYNC_DELAY_TIME);
+
+        beginTest ("past the cap");
+        checkEcho (60.0, 4, noteValueIndex (fourBars, dotted), MAX_SYNC_DELAY_TIME);
+        checkEcho (60.0, 7, noteValueIndex (fourBars, straight), MAX_SYNC_DELAY_TIME);
+    }
+
+private:
+    // Wet only and without feedback, so the output is the impulse again after exactly the delay time,
+    // and silence everywhere else - an echo arriving early would mean the read head wrapped round
+    void checkEcho (double bpm, int timeSigNumerator, int noteValue, double expectedSeconds)
+    {
+        RenderHarness harness (1, syncSampleRate, 1024, false);
+        harness.setParameters ({ { "mode", 0 }, { "feedback", 0.0f }, { "dryWet", 1.0f },
+                                 { "sync", 1 }, { "noteValue", (float) noteValue },
+                                 { "governor", 0 }, { "multithread", 0 } });
+        harness.restartAtTempo (bpm, timeSigNumerator, 4);
+
+        const auto echoSample = juce::roundToInt (expectedSeconds * syncSampleRate);
+
+        juce::AudioBuffer<float> buffer (1, echoSample + 1024);
+        buffer.clear();
+        buffer.setSample (0, 0, 1.0f);
+        harness.render (buffer, { 1024 });
+
+        auto stray = 0.0f;
+        auto straySample = -1;
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            if (i != echoSample && std::abs (buffer.getSample (0, i)) > stray)
+            {
+                stray = std::abs (buffer.getSample (0, i));
+                straySample = i;
+            }
+        }
+
+        expectWithinAbsoluteError (buffer.getSample (0, echoSample), 1.0f, 1.0e-6f,
+                                   "no echo at " + juce::String (expectedSeconds) + " s");
+        expect (stray < 1.0e-6f, "output of " + juce::String (stray) + " at sample " + juce::String (straySample)
+                                   + ", the echo belongs at " + juce::String (echoSample));
+    }
+};
+
+static TempoSyncTests tempoSyncTests;
@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+
+    TestSettings.h
+
+    Command-line options shared with the tests, set up by main() before any
+    test runs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+struct TestSettings
+{
+    juce::File goldenDirectory;         // expected renders, one .wav per case
+    bool updateGoldens = false;         // write the renders as the new goldens instead of comparing
+
+    bool runBenchmarks = false;
+    juce::File baselineFile;            // per-path ns/sample to gate against, which has to exist
+    juce::File newBaselineFile;         // where to record this run's ns/sample
+    double maxRegression = 0.25;        // how much slower than the baseline a path may get
+};
+
+TestSettings& getTestSettings();
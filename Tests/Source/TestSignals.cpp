@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    TestSignals.cpp
+
+  ==============================================================================
+*/
+
+#include "TestSignals.h"
+
+namespace TestSignals
+{
+    juce::String getName (Signal signal)
+    {
+        switch (signal)
+        {
+            case Signal::impulses:   return "impulses";
+            case Signal::sweep:      return "sweep";
+            case Signal::noise:      return "noise";
+            case Signal::automation: return "automation";
+        }
+
+        return {};
+    }
+
+    void generate (Signal signal, juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        auto numSamples = buffer.getNumSamples();
+        buffer.clear();
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* data = buffer.getWritePointer (channel);
+
+            switch (signal)
+            {
+                case Signal::impulses:
+                {
+                    // Uneven spacing, so echoes of one click never land on another click
+                    const double times[] = { 0.0, 0.13, 0.29 };
+                    const float gains[] = { 1.0f, 0.5f, -0.75f };
+
+                    for (int i = 0; i < (int) juce::numElementsInArray (times); ++i)
+                    {
+                        auto position = (int) (times[i] * sampleRate) + channel * 7;
+
+                        if (position < numSamples)
+                            data[position] = gains[i];
+                    }
+
+                    break;
+                }
+
+                case Signal::sweep:
+                {
+                    const double startFrequency = 20.0, endFrequency = 20000.0;
+                    const double duration = numSamples / sampleRate;
+                    const double rate = std::log (endFrequency / startFrequency);
+
+                    for (int i = 0; i < numSamples; ++i)
+                    {
+                        auto t = i / sampleRate;
+                        auto phase = juce::MathConstants<double>::twoPi * startFrequency * duration / rate
+                                       * (std::exp (t / duration * rate) - 1.0);
+
+                        data[i] = 0.5f * (float) std::sin (phase + channel * 0.5);
+                    }
+
+                    break;
+                }
+
+                case Signal::noise:
+                case Signal::automation:
+                {
+                    NoiseGenerator noise ((signal == Signal::noise ? 0x1234u : 0xa070u) + (juce::uint32) channel);
+
+                    for (int i = 0; i < numSamples; ++i)
+                        data[i] = 0.25f * noise.nextSample();
+
+                    break;
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    NoiseGenerator::NoiseGenerator (juce::uint32 seed)
+        : state (seed != 0 ? seed : 1)
+    {
+    }
+
+    float NoiseGenerator::nextSample()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        return (float) ((double) state / 2147483648.0 - 1.0);
+    }
+}
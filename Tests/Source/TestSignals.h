@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    TestSignals.h
+
+    The test corpus. Every signal is generated in code from a fixed seed, so
+    the inputs to the golden renders never change and nothing but the expected
+    outputs has to be stored.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace TestSignals
+{
+    enum class Signal
+    {
+        impulses,   // a few isolated clicks, the echoes show up as clean copies
+        sweep,      // exponential sine sweep over the audio band
+        noise,      // white noise, exercises every bin and every interpolation fraction
+        automation  // noise again, rendered while the parameters ramp (see GoldenTests.cpp)
+    };
+
+    static constexpr int numSignals = 4;
+
+    juce::String getName (Signal signal);
+
+    // Fills every channel of buffer, each channel with its own variation of the signal
+    void generate (Signal signal, juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    //==============================================================================
+    // xorshift32 - the noise is generated here rather than with juce::Random so the
+    // corpus can't change underneath the goldens
+    class NoiseGenerator
+    {
+    public:
+        explicit NoiseGenerator (juce::uint32 seed);
+
+        float nextSample(); // uniform in [-1, 1)
+
+    private:
+        juce::uint32 state;
+    };
+}